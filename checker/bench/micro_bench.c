@@ -0,0 +1,496 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../main/checker.h"
+#include "../utils/utils.h"
+#include "../reporter/reporter.h"
+#include "../validators/validators.h"
+#include "../validators/rules/rules.h"
+
+#ifndef BENCH_COMMIT
+#define BENCH_COMMIT "unknown"
+#endif
+
+#define MAX_SAMPLES 64
+#define MIN_SAMPLE_NS 2000000.0
+
+/*
+ * Microbenchmarks for the checker's hot functions. Each case is warmed up,
+ * then timed over several samples; a sample repeats the operation until it
+ * lasts at least MIN_SAMPLE_NS so short operations are not lost in timer
+ * noise. Results are written as JSON so runs can be diffed across commits.
+ */
+
+typedef int (*BenchFn)(void *arg);
+
+typedef struct {
+	int samples;
+	int warmup;
+	FILE *json;
+	int first;
+	char dir[64];
+} BenchRun;
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void run_case(BenchRun *run, const char *name, const char *param, long value,
+		BenchFn fn, void *arg)
+{
+	double samples[MAX_SAMPLES];
+	double start, elapsed, mean = 0, var = 0;
+	long iterations = 1, i;
+	int s, n = run->samples;
+
+	for (s = 0; s < run->warmup; s++)
+		fn(arg);
+
+	/* Calibrate: double the inner loop until one sample is long enough */
+	for (;;)
+	{
+		start = now_ns();
+		for (i = 0; i < iterations; i++)
+			fn(arg);
+		elapsed = now_ns() - start;
+		if (elapsed >= MIN_SAMPLE_NS || iterations >= (1L << 24))
+			break;
+		iterations *= 2;
+	}
+
+	for (s = 0; s < n; s++)
+	{
+		start = now_ns();
+		for (i = 0; i < iterations; i++)
+			fn(arg);
+		samples[s] = (now_ns() - start) / iterations;
+		mean += samples[s];
+	}
+	mean /= n;
+	for (s = 0; s < n; s++)
+		var += (samples[s] - mean) * (samples[s] - mean);
+	var = n > 1 ? var / (n - 1) : 0;
+	qsort(samples, n, sizeof(samples[0]), compare_double);
+
+	fprintf(run->json,
+			"%s\n    {\"name\": \"%s\", \"params\": {\"%s\": %ld}, \"samples\": %d, "
+			"\"iterations\": %ld,\n     \"ns_per_op\": {\"min\": %.1f, \"median\": %.1f, "
+			"\"mean\": %.1f, \"p95\": %.1f, \"stddev\": %.1f}}",
+			run->first ? "" : ",", name, param, value, n, iterations,
+			samples[0], samples[n / 2], mean, samples[(n * 95) / 100 < n ? (n * 95) / 100 : n - 1],
+			sqrt(var));
+	run->first = 0;
+}
+
+/* Writes @size bytes of Python-looking text, returns 0 on success */
+static int write_file(const char *path, const char *header, const char *line, long size)
+{
+	FILE *fp;
+	long written = 0;
+
+	fp = fopen(path, "w");
+	if (!fp)
+		return 1;
+	if (header)
+		written += fprintf(fp, "%s", header);
+	while (written < size)
+		written += fprintf(fp, "%s", line);
+	fclose(fp);
+	return 0;
+}
+
+/* compute_file_hash, first call of a run and again on the shared file cache */
+
+typedef struct {
+	char path[256];
+	char hex[HASH_LENGTH];
+} HashArg;
+
+static int bench_hash(void *arg)
+{
+	HashArg *h = arg;
+
+	file_cache_clear();
+	return compute_file_hash(h->path, h->hex);
+}
+
+static int bench_hash_cached(void *arg)
+{
+	HashArg *h = arg;
+
+	return compute_file_hash(h->path, h->hex);
+}
+
+static void bench_file_hash(BenchRun *run)
+{
+	static const long sizes[] = { 1024, 65536, 1048576, 16777216 };
+	HashArg h;
+	size_t i;
+
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		snprintf(h.path, sizeof(h.path), "%s/hash_%ld.bin", run->dir, sizes[i]);
+		if (write_file(h.path, NULL, "0123456789abcdef", sizes[i]) != 0)
+			continue;
+		run_case(run, "compute_file_hash", "bytes", sizes[i], bench_hash, &h);
+		run_case(run, "compute_file_hash_cached", "bytes", sizes[i], bench_hash_cached, &h);
+		file_cache_clear();
+		unlink(h.path);
+	}
+}
+
+/* is_duplicate_hash: the probe hash is absent so every line is scanned */
+
+typedef struct {
+	char log_path[256];
+} DupArg;
+
+static int bench_dup(void *arg)
+{
+	DupArg *d = arg;
+
+	return is_duplicate_hash("probe", "probe/file.py",
+			"ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff", d->log_path);
+}
+
+static void bench_duplicate_hash(BenchRun *run)
+{
+	static const long lines[] = { 10000, 100000, 1000000 };
+	DupArg d;
+	FILE *fp;
+	size_t i;
+	long l;
+
+	for (i = 0; i < sizeof(lines) / sizeof(lines[0]); i++)
+	{
+		snprintf(d.log_path, sizeof(d.log_path), "%s/hashes_%ld.log", run->dir, lines[i]);
+		fp = fopen(d.log_path, "w");
+		if (!fp)
+			continue;
+		for (l = 0; l < lines[i]; l++)
+		{
+			fprintf(fp, "user%ld:cloned_repo_user%ld/algorithms/tasks/recursion/recursion.py:"
+					"%064lx\n", l, l, l);
+		}
+		fclose(fp);
+		run_case(run, "is_duplicate_hash", "log_lines", lines[i], bench_dup, &d);
+		unlink(d.log_path);
+	}
+}
+
+/* map_get() hits and misses as the map grows through several resizes */
+
+typedef struct {
+	HashMap *map;
+	char **keys;
+	long count;
+	long next;
+} MapArg;
+
+static int bench_get(void *arg)
+{
+	MapArg *t = arg;
+	ValidatorFn *fn;
+
+	fn = map_get(t->map, t->keys[t->next]);
+	t->next = (t->next + 1) % t->count;
+	return fn != NULL;
+}
+
+static void bench_hash_map(BenchRun *run)
+{
+	static const long counts[] = { 256, 1024, 4096, 16384 };
+	char key[32];
+	MapArg t, miss;
+	size_t i;
+	long k;
+
+	for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++)
+	{
+		t.map = map_create(sizeof(ValidatorFn), NULL);
+		t.keys = malloc(sizeof(char *) * counts[i]);
+		miss.keys = malloc(sizeof(char *) * counts[i]);
+		if (!t.map || !t.keys || !miss.keys)
+			return;
+		for (k = 0; k < counts[i]; k++)
+		{
+			snprintf(key, sizeof(key), "task_%ld", k);
+			t.keys[k] = strdup(key);
+			map_put(t.map, key, NULL);
+			snprintf(key, sizeof(key), "missing_%ld", k);
+			miss.keys[k] = strdup(key);
+		}
+		t.count = miss.count = counts[i];
+		t.next = miss.next = 0;
+		miss.map = t.map;
+		run_case(run, "map_get_hit", "keys", counts[i], bench_get, &t);
+		run_case(run, "map_get_miss", "keys", counts[i], bench_get, &miss);
+		map_free(t.map);
+		for (k = 0; k < counts[i]; k++)
+		{
+			free(t.keys[k]);
+			free(miss.keys[k]);
+		}
+		free(t.keys);
+		free(miss.keys);
+	}
+}
+
+/* load_tasks on catalogs of growing size */
+
+typedef struct {
+	char path[256];
+} CatalogArg;
+
+static int bench_load(void *arg)
+{
+	CatalogArg *c = arg;
+	TaskList tasks;
+	int ret;
+
+	if (task_list_init(&tasks) != 0)
+		return 1;
+	ret = load_tasks(c->path, NULL, &tasks);
+	task_list_free(&tasks);
+	return ret;
+}
+
+static int bench_catalog(void *arg)
+{
+	CatalogArg *c = arg;
+	Catalog catalog;
+	int ret;
+
+	ret = catalog_load(c->path, &catalog);
+	catalog_free(&catalog);
+	return ret;
+}
+
+static void bench_load_tasks(BenchRun *run)
+{
+	static const long sizes[] = { 10, 100, 1000, 10000 };
+	CatalogArg c;
+	FILE *fp;
+	size_t i;
+	long t;
+
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		snprintf(c.path, sizeof(c.path), "%s/catalog_%ld.json", run->dir, sizes[i]);
+		fp = fopen(c.path, "w");
+		if (!fp)
+			continue;
+		fprintf(fp, "[\n");
+		for (t = 0; t < sizes[i]; t++)
+		{
+			fprintf(fp, "%s{\"name\": \"task_%ld\", \"path\": \"algorithms/tasks/task_%ld\", "
+					"\"main\": \"main.py\", \"target\": \"task_%ld.py\", "
+					"\"expected_output\": \"line one\\nline two\\n\"}\n",
+					t ? "," : "", t, t, t);
+		}
+		fprintf(fp, "]\n");
+		fclose(fp);
+		run_case(run, "load_tasks", "catalog_tasks", sizes[i], bench_load, &c);
+		/* Warm index: the warm-up run compiles it, samples only map it */
+		run_case(run, "catalog_load", "catalog_tasks", sizes[i], bench_catalog, &c);
+		unlink(c.path);
+	}
+}
+
+/* rules_check_file with the recursion and factorial catalog rules on long files */
+
+#define BENCH_RULES(name) "{\"header\": [\"#!/usr/bin/env python3\", \"\"], " \
+	"\"signature\": \"def " name "(*\", \"docstring\": \"definition\", " \
+	"\"banned\": [\"for\", \"while\"]}"
+
+typedef struct {
+	char path[256];
+	const char *task;
+	const RuleSet *rules;
+} ValidatorArg;
+
+static int bench_validator(void *arg)
+{
+	ValidatorArg *v = arg;
+
+	/* Map the file each time, as the first check of a run does */
+	file_cache_clear();
+	return rules_check_file(v->rules, v->task, v->path);
+}
+
+static void bench_validators(BenchRun *run)
+{
+	static const long sizes[] = { 4096, 262144, 4194304 };
+	const RuleSet *recursion, *factorial;
+	ValidatorArg v;
+	Arena *arena;
+	size_t i;
+
+	arena = arena_create();
+	recursion = arena ? rules_compile(BENCH_RULES("recursion"), arena) : NULL;
+	factorial = arena ? rules_compile(BENCH_RULES("factorial"), arena) : NULL;
+	for (i = 0; recursion && factorial && i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		snprintf(v.path, sizeof(v.path), "%s/recursion.py", run->dir);
+		v.task = "recursion";
+		v.rules = recursion;
+		if (write_file(v.path, "#!/usr/bin/env python3\n\ndef recursion(n):\n"
+					"    \"\"\"Print n down to 0.\"\"\"\n",
+					"    value = n - 1  # keep recursing\n", sizes[i]) == 0)
+			run_case(run, "rules_check_recursion", "bytes", sizes[i], bench_validator, &v);
+		unlink(v.path);
+
+		snprintf(v.path, sizeof(v.path), "%s/factorial.py", run->dir);
+		v.task = "factorial";
+		v.rules = factorial;
+		if (write_file(v.path, "#!/usr/bin/env python3\n\ndef factorial(n):\n"
+					"    \"\"\"Return n!.\"\"\"\n",
+					"    value = n * 1  # keep multiplying\n", sizes[i]) == 0)
+			run_case(run, "rules_check_factorial", "bytes", sizes[i], bench_validator, &v);
+		unlink(v.path);
+	}
+	arena_destroy(arena);
+}
+
+/* check_output: run a script and compare its output */
+
+typedef struct {
+	char script[256];
+	char *expected;
+} OutputArg;
+
+static int bench_output(void *arg)
+{
+	OutputArg *o = arg;
+
+	return check_output(o->script, o->expected);
+}
+
+static void bench_check_output(BenchRun *run)
+{
+	static const long sizes[] = { 64, 1024, 4000 };
+	OutputArg o;
+	char data_path[256];
+	FILE *fp;
+	size_t i;
+	long b;
+
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		snprintf(data_path, sizeof(data_path), "%s/expected_%ld.txt", run->dir, sizes[i]);
+		snprintf(o.script, sizeof(o.script), "%s/main_%ld.sh", run->dir, sizes[i]);
+		o.expected = malloc(sizes[i] + 1);
+		if (!o.expected)
+			return;
+		for (b = 0; b < sizes[i]; b++)
+			o.expected[b] = (b % 32 == 31) ? '\n' : 'a' + b % 26;
+		o.expected[sizes[i]] = '\0';
+
+		fp = fopen(data_path, "w");
+		if (fp)
+		{
+			fputs(o.expected, fp);
+			fclose(fp);
+		}
+		fp = fopen(o.script, "w");
+		if (fp)
+		{
+			fprintf(fp, "#!/bin/sh\ncat %s\n", data_path);
+			fclose(fp);
+			chmod(o.script, 0755);
+			run_case(run, "check_output", "bytes", sizes[i], bench_output, &o);
+		}
+		unlink(o.script);
+		unlink(data_path);
+		free(o.expected);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	BenchRun run;
+	const char *output = NULL;
+	const char *only = NULL;
+	int saved_out, saved_err, devnull, i;
+
+	memset(&run, 0, sizeof(run));
+	run.samples = 15;
+	run.warmup = 3;
+	run.first = 1;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+			output = argv[++i];
+		else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc)
+			run.samples = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--only") == 0 && i + 1 < argc)
+			only = argv[++i];
+	}
+	if (run.samples < 3 || run.samples > MAX_SAMPLES)
+		run.samples = 15;
+
+	run.json = output ? fopen(output, "w") : stdout;
+	strcpy(run.dir, "/tmp/checker-micro.XXXXXX");
+	if (!run.json || !mkdtemp(run.dir))
+	{
+		perror("micro_bench");
+		return 1;
+	}
+
+	/* Validators and check_output report as they go; keep that out of the JSON */
+	report_init("plain");
+	fflush(stdout);
+	saved_out = dup(STDOUT_FILENO);
+	saved_err = dup(STDERR_FILENO);
+	devnull = open("/dev/null", O_WRONLY);
+	if (output && devnull >= 0)
+	{
+		dup2(devnull, STDOUT_FILENO);
+		dup2(devnull, STDERR_FILENO);
+	}
+
+	fprintf(run.json, "{\n  \"commit\": \"%s\",\n  \"samples\": %d,\n  \"benchmarks\": [",
+			BENCH_COMMIT, run.samples);
+
+	if (!only || strcmp(only, "hash") == 0)
+		bench_file_hash(&run);
+	if (!only || strcmp(only, "duplicate") == 0)
+		bench_duplicate_hash(&run);
+	if (!only || strcmp(only, "map") == 0)
+		bench_hash_map(&run);
+	if (!only || strcmp(only, "load") == 0)
+		bench_load_tasks(&run);
+	if (!only || strcmp(only, "validators") == 0)
+		bench_validators(&run);
+	if (!only || strcmp(only, "output") == 0)
+		bench_check_output(&run);
+
+	fprintf(run.json, "\n  ]\n}\n");
+	report_flush();
+	if (output)
+		fclose(run.json);
+
+	dup2(saved_out, STDOUT_FILENO);
+	dup2(saved_err, STDERR_FILENO);
+	rmdir(run.dir);
+	if (output)
+		printf("Microbenchmark results written to %s\n", output);
+	return 0;
+}
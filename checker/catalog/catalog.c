@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "catalog.h"
+#include "../utils/utils.h"
+#include "../reporter/reporter.h"
+#include "../trace/trace.h"
+
+static void index_path_for(const char *source, char *path, size_t size)
+{
+	snprintf(path, size, "%s/catalog.%08x.idx", CACHE_DIR, catalog_hash(source, 0));
+}
+
+static int offset_ok(const CatalogIndex *index, uint32_t offset)
+{
+	return offset == CATALOG_NONE ||
+		offset < index->header->file_size - index->header->pool_offset;
+}
+
+/* Maps @path and checks that every offset in it stays inside the file */
+static CatalogIndex *map_index(const char *path, int source_count)
+{
+	const CatalogHeader *h;
+	CatalogIndex *index;
+	struct stat st;
+	uint32_t i, f;
+	int fd, ok;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CatalogHeader))
+	{
+		close(fd);
+		return NULL;
+	}
+
+	index = calloc(1, sizeof(*index));
+	if (!index)
+	{
+		close(fd);
+		return NULL;
+	}
+	index->size = st.st_size;
+	index->map = mmap(NULL, index->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (index->map == MAP_FAILED)
+	{
+		free(index);
+		return NULL;
+	}
+
+	h = index->header = index->map;
+	ok = h->magic == CATALOG_MAGIC && h->version == CATALOG_VERSION &&
+		h->file_size == index->size && (int)h->source_count == source_count &&
+		h->bucket_count > 0 && h->slot_count > h->task_count &&
+		h->seeds_offset == sizeof(*h) &&
+		h->slots_offset == h->seeds_offset + h->bucket_count * sizeof(uint32_t) &&
+		h->records_offset == h->slots_offset + h->slot_count * sizeof(uint32_t) &&
+		h->files_offset == h->records_offset + h->task_count * sizeof(CatalogRecord) &&
+		h->pool_offset >= h->files_offset && h->pool_offset < h->file_size &&
+		((char *)index->map)[h->file_size - 1] == '\0';
+	if (ok)
+	{
+		index->seeds = (const uint32_t *)((const char *)index->map + h->seeds_offset);
+		index->slots = (const uint32_t *)((const char *)index->map + h->slots_offset);
+		index->records = (const CatalogRecord *)((const char *)index->map + h->records_offset);
+		index->files = (const uint32_t *)((const char *)index->map + h->files_offset);
+		index->pool = (const char *)index->map + h->pool_offset;
+	}
+	for (i = 0; ok && i < h->slot_count; i++)
+		ok = index->slots[i] == CATALOG_NONE || index->slots[i] < h->task_count;
+	for (i = 0; ok && i < h->task_count; i++)
+	{
+		ok = index->records[i].name != CATALOG_NONE && offset_ok(index, index->records[i].name) &&
+			offset_ok(index, index->records[i].path) && offset_ok(index, index->records[i].main) &&
+			offset_ok(index, index->records[i].target) &&
+			offset_ok(index, index->records[i].expected_output) &&
+			offset_ok(index, index->records[i].rules) &&
+			index->records[i].files + index->records[i].file_count <=
+			(h->pool_offset - h->files_offset) / sizeof(uint32_t);
+		for (f = 0; ok && f < index->records[i].file_count; f++)
+			ok = offset_ok(index, index->files[index->records[i].files + f]);
+	}
+
+	if (!ok)
+	{
+		munmap(index->map, index->size);
+		free(index);
+		return NULL;
+	}
+	return index;
+}
+
+static const char *pool_string(const CatalogIndex *index, uint32_t offset)
+{
+	return offset == CATALOG_NONE ? NULL : index->pool + offset;
+}
+
+static int index_is_fresh(const char *path, const struct timespec *newest)
+{
+	struct stat st;
+
+	if (stat(path, &st) != 0)
+		return 0;
+	return st.st_mtim.tv_sec > newest->tv_sec ||
+		(st.st_mtim.tv_sec == newest->tv_sec && st.st_mtim.tv_nsec > newest->tv_nsec);
+}
+
+/* Fallback when no index can be built or mapped: parse the JSON directly */
+static int load_json(const char *source, Catalog *catalog)
+{
+	int i, *position;
+
+	if (load_tasks(source, NULL, &catalog->tasks) != 0)
+		return 1;
+	catalog->by_name = map_create(sizeof(int), catalog->tasks.arena);
+	for (i = 0; catalog->by_name && i < catalog->tasks.count; i++)
+	{
+		/* The first task of a name wins, as it does in the index */
+		position = map_put(catalog->by_name, catalog->tasks.items[i].task_name, NULL);
+		if (position && !*position)
+			*position = i + 1;
+	}
+	return 0;
+}
+
+/**
+ * catalog_load - Loads the task catalog through its compiled index.
+ * @source: Catalog file or directory of JSON files
+ * @catalog: Filled in; release with catalog_free()
+ *
+ * The index lives in CACHE_DIR and is recompiled whenever a JSON file is
+ * newer than it or files were added or removed, then mapped read-only, so
+ * a warm load costs a few stat() calls and no JSON parsing.
+ *
+ * Return: 0 on success, 1 if no task could be loaded
+ */
+int catalog_load(const char *source, Catalog *catalog)
+{
+	char path[512];
+	struct timespec newest;
+	CatalogIndex *index = NULL;
+	const CatalogRecord *rec;
+	Task *task;
+	int sources;
+	uint32_t i, f;
+
+	memset(catalog, 0, sizeof(*catalog));
+	if (task_list_init(&catalog->tasks) != 0)
+		return 1;
+	sources = catalog_sources(source, &newest);
+	if (sources <= 0)
+		return load_json(source, catalog);
+
+	index_path_for(source, path, sizeof(path));
+	if (index_is_fresh(path, &newest))
+		index = map_index(path, sources);
+	if (!index)
+	{
+		mkdir(CACHE_DIR, 0755);
+		if (catalog_build(source, path) == 0)
+			index = map_index(path, sources);
+	}
+	if (!index)
+	{
+		report_error("Warning: catalog index unavailable, reading %s directly\n", source);
+		return load_json(source, catalog);
+	}
+
+	/* Tasks are rebuilt in the arena, their strings stay in the map */
+	catalog->index = index;
+	catalog->tasks.items = arena_alloc(catalog->tasks.arena,
+			sizeof(Task) * (index->header->task_count + 1));
+	if (!catalog->tasks.items)
+		return 1;
+	catalog->tasks.capacity = index->header->task_count + 1;
+	for (i = 0; i < index->header->task_count; i++)
+	{
+		rec = &index->records[i];
+		task = task_list_add(&catalog->tasks);
+		if (!task)
+			return 1;
+		task->task_name = pool_string(index, rec->name);
+		task->expected_path = pool_string(index, rec->path);
+		task->main_file = pool_string(index, rec->main);
+		task->target_file = pool_string(index, rec->target);
+		task->expected_output = pool_string(index, rec->expected_output);
+		task->rules = pool_string(index, rec->rules);
+		task->expected_files = arena_alloc(catalog->tasks.arena,
+				sizeof(*task->expected_files) * (rec->file_count + 1));
+		if (!task->expected_files)
+			return 1;
+		for (f = 0; f < rec->file_count; f++)
+			task->expected_files[f] = pool_string(index, index->files[rec->files + f]);
+		task->file_count = f;
+	}
+	return catalog->tasks.count > 0 ? 0 : 1;
+}
+
+/**
+ * catalog_find - Looks a task up by name.
+ * @catalog: Loaded catalog
+ * @name: Task name
+ *
+ * Return: Position of the task in catalog->tasks.items, -1 if there is none
+ */
+int catalog_find(const Catalog *catalog, const char *name)
+{
+	const CatalogIndex *index = catalog->index;
+	uint32_t seed, slot;
+	int i, *position;
+
+	if (!index)
+	{
+		if (catalog->by_name)
+		{
+			position = map_get(catalog->by_name, name);
+			return position ? *position - 1 : -1;
+		}
+		for (i = 0; i < catalog->tasks.count; i++)
+		{
+			if (strcmp(catalog->tasks.items[i].task_name, name) == 0)
+				return i;
+		}
+		return -1;
+	}
+
+	seed = index->seeds[catalog_hash(name, 0) % index->header->bucket_count];
+	slot = index->slots[catalog_hash(name, seed) % index->header->slot_count];
+	if (slot == CATALOG_NONE || strcmp(catalog->tasks.items[slot].task_name, name) != 0)
+		return -1;
+	return (int)slot;
+}
+
+void catalog_free(Catalog *catalog)
+{
+	if (catalog->index)
+	{
+		munmap(catalog->index->map, catalog->index->size);
+		free(catalog->index);
+	}
+	map_free(catalog->by_name);
+	task_list_free(&catalog->tasks);
+	memset(catalog, 0, sizeof(*catalog));
+}
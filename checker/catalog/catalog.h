@@ -0,0 +1,64 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <stdint.h>
+#include <time.h>
+#include "../main/checker.h"
+
+/*
+ * Compiled catalog index, one file per catalog source under CACHE_DIR:
+ *
+ *   CatalogHeader | seeds[bucket_count] | slots[slot_count]
+ *   | records[task_count] | files[file_total] | string pool
+ *
+ * A task name is found with a hash-and-displace perfect hash: the name's
+ * bucket gives a seed, the seeded hash gives a slot, the slot gives the
+ * record. Strings are offsets into the pool, NUL-terminated.
+ */
+
+#define CATALOG_MAGIC 0x58494b43 /* "CKIX" */
+#define CATALOG_VERSION 2
+#define CATALOG_NONE 0xffffffffu
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t task_count;
+	uint32_t bucket_count;
+	uint32_t slot_count;
+	uint32_t source_count;
+	uint32_t seeds_offset;
+	uint32_t slots_offset;
+	uint32_t records_offset;
+	uint32_t files_offset;
+	uint32_t pool_offset;
+	uint32_t file_size;
+} CatalogHeader;
+
+typedef struct {
+	uint32_t name;
+	uint32_t path;
+	uint32_t main;
+	uint32_t target;
+	uint32_t expected_output;
+	uint32_t rules;
+	uint32_t files;
+	uint32_t file_count;
+} CatalogRecord;
+
+struct CatalogIndex {
+	void *map;
+	size_t size;
+	const CatalogHeader *header;
+	const uint32_t *seeds;
+	const uint32_t *slots;
+	const CatalogRecord *records;
+	const uint32_t *files;
+	const char *pool;
+};
+
+uint32_t catalog_hash(const char *key, uint32_t seed);
+int catalog_sources(const char *source, struct timespec *newest);
+int catalog_build(const char *source, const char *index_path);
+
+#endif
@@ -0,0 +1,334 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "catalog.h"
+#include "../utils/utils.h"
+#include "../reporter/reporter.h"
+#include "../trace/trace.h"
+
+#define MAX_SEED (1u << 22)
+
+typedef struct {
+	char *data;
+	size_t len;
+	size_t cap;
+} StringPool;
+
+typedef struct {
+	uint32_t bucket;
+	uint32_t size;
+} BucketOrder;
+
+/* FNV-1a with a seeded basis and a murmur3 finaliser */
+uint32_t catalog_hash(const char *key, uint32_t seed)
+{
+	uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+
+	while (*key)
+	{
+		h ^= (unsigned char)*key++;
+		h *= 16777619u;
+	}
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+static int count_sources(const char *path, struct timespec *newest)
+{
+	struct dirent *entry;
+	struct stat st;
+	char child[1024];
+	DIR *dir;
+	int count = 0, sub;
+
+	if (stat(path, &st) != 0)
+		return -1;
+	if (!S_ISDIR(st.st_mode))
+	{
+		if (st.st_mtim.tv_sec > newest->tv_sec ||
+				(st.st_mtim.tv_sec == newest->tv_sec && st.st_mtim.tv_nsec > newest->tv_nsec))
+			*newest = st.st_mtim;
+		return 1;
+	}
+
+	dir = opendir(path);
+	if (!dir)
+		return -1;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+			continue;
+		snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+		/* Same selection as load_tasks_from_directory() */
+		if (entry->d_type == DT_DIR || (entry->d_type == DT_REG && strstr(entry->d_name, ".json")))
+		{
+			sub = count_sources(child, newest);
+			if (sub > 0)
+				count += sub;
+		}
+	}
+	closedir(dir);
+	return count;
+}
+
+/**
+ * catalog_sources - Counts the JSON files behind a catalog.
+ * @source: Catalog file or directory
+ * @newest: Receives the modification time of the most recent one
+ *
+ * Return: number of source files, -1 if @source cannot be read
+ */
+int catalog_sources(const char *source, struct timespec *newest)
+{
+	newest->tv_sec = 0;
+	newest->tv_nsec = 0;
+	return count_sources(source, newest);
+}
+
+static uint32_t pool_add(StringPool *pool, const char *str)
+{
+	size_t len, offset;
+	char *grown;
+
+	if (!str)
+		return CATALOG_NONE;
+	len = strlen(str) + 1;
+	if (pool->len + len > pool->cap)
+	{
+		pool->cap = (pool->cap + len) * 2;
+		grown = realloc(pool->data, pool->cap);
+		if (!grown)
+			return CATALOG_NONE;
+		pool->data = grown;
+	}
+	offset = pool->len;
+	memcpy(pool->data + offset, str, len);
+	pool->len += len;
+	return (uint32_t)offset;
+}
+
+static int by_size_desc(const void *a, const void *b)
+{
+	const BucketOrder *x = a, *y = b;
+
+	return (x->size < y->size) - (x->size > y->size);
+}
+
+/*
+ * Hash and displace: buckets are placed largest first, each trying seeds
+ * until all of its names land on distinct free slots.
+ */
+static int place_keys(const char **names, uint32_t count, uint32_t *seeds,
+		uint32_t bucket_count, uint32_t *slots, uint32_t slot_count)
+{
+	uint32_t *start, *members, *fill, *pos;
+	BucketOrder *order;
+	uint32_t i, j, k, b, seed;
+	int ok = 0, clash;
+
+	start = calloc(bucket_count + 1, sizeof(*start));
+	members = malloc(sizeof(*members) * (count + 1));
+	fill = calloc(bucket_count, sizeof(*fill));
+	pos = malloc(sizeof(*pos) * (count + 1));
+	order = malloc(sizeof(*order) * bucket_count);
+	if (!start || !members || !fill || !pos || !order)
+		goto done;
+
+	for (i = 0; i < count; i++)
+		start[catalog_hash(names[i], 0) % bucket_count + 1]++;
+	for (b = 0; b < bucket_count; b++)
+	{
+		order[b].bucket = b;
+		order[b].size = start[b + 1];
+		start[b + 1] += start[b];
+	}
+	for (i = 0; i < count; i++)
+	{
+		b = catalog_hash(names[i], 0) % bucket_count;
+		members[start[b] + fill[b]++] = i;
+	}
+	qsort(order, bucket_count, sizeof(*order), by_size_desc);
+
+	for (i = 0; i < slot_count; i++)
+		slots[i] = CATALOG_NONE;
+	for (i = 0; i < bucket_count; i++)
+	{
+		b = order[i].bucket;
+		seeds[b] = 0;
+		if (order[i].size == 0)
+			continue;
+		for (seed = 1; seed < MAX_SEED; seed++)
+		{
+			clash = 0;
+			for (j = 0; j < order[i].size && !clash; j++)
+			{
+				pos[j] = catalog_hash(names[members[start[b] + j]], seed) % slot_count;
+				clash = slots[pos[j]] != CATALOG_NONE;
+				for (k = 0; k < j && !clash; k++)
+					clash = pos[k] == pos[j];
+			}
+			if (!clash)
+				break;
+		}
+		if (seed == MAX_SEED)
+			goto done;
+		seeds[b] = seed;
+		for (j = 0; j < order[i].size; j++)
+			slots[pos[j]] = members[start[b] + j];
+	}
+	ok = 1;
+
+done:
+	free(start);
+	free(members);
+	free(fill);
+	free(pos);
+	free(order);
+	return ok ? 0 : 1;
+}
+
+static int write_index(const char *index_path, const CatalogHeader *header,
+		const uint32_t *seeds, const uint32_t *slots, const CatalogRecord *records,
+		const uint32_t *files, const StringPool *pool)
+{
+	char tmp[600];
+	FILE *fp;
+	int ok;
+
+	snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", index_path, (long)getpid());
+	fp = fopen(tmp, "wb");
+	if (!fp)
+		return 1;
+	fwrite(header, sizeof(*header), 1, fp);
+	fwrite(seeds, sizeof(*seeds), header->bucket_count, fp);
+	fwrite(slots, sizeof(*slots), header->slot_count, fp);
+	fwrite(records, sizeof(*records), header->task_count, fp);
+	fwrite(files, sizeof(*files), (header->pool_offset - header->files_offset) / sizeof(*files), fp);
+	fwrite(pool->data, 1, pool->len, fp);
+	ok = !ferror(fp);
+	if (fclose(fp) != 0 || !ok || rename(tmp, index_path) != 0)
+	{
+		unlink(tmp);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * catalog_build - Compiles a JSON catalog into a binary index.
+ * @source: Catalog file or directory, as accepted by load_tasks()
+ * @index_path: Where to write the index (atomically, via rename)
+ *
+ * Later duplicates of a task name are dropped, matching the first-match
+ * lookup of the JSON loader.
+ *
+ * Return: 0 on success, 1 otherwise
+ */
+int catalog_build(const char *source, const char *index_path)
+{
+	TaskList tasks;
+	CatalogHeader header;
+	CatalogRecord *records = NULL;
+	StringPool pool;
+	struct timespec newest;
+	const char **names = NULL;
+	HashMap *seen = NULL;
+	uint32_t *seeds = NULL, *slots = NULL, *files = NULL;
+	uint32_t count = 0, file_total = 0, f;
+	int i, j, ret = 1;
+
+	memset(&pool, 0, sizeof(pool));
+	memset(&header, 0, sizeof(header));
+	TRACE_BEGIN("catalog_build", source);
+	if (task_list_init(&tasks) != 0 || load_tasks(source, NULL, &tasks) != 0)
+		goto done;
+
+	names = malloc(sizeof(*names) * (tasks.count + 1));
+	records = calloc(tasks.count + 1, sizeof(*records));
+	if (!names || !records)
+		goto done;
+	seen = map_create(0, tasks.arena);
+	if (!seen)
+		goto done;
+	for (i = 0; i < tasks.count; i++)
+	{
+		j = map_add(seen, tasks.items[i].task_name);
+		if (j < 0)
+			goto done;
+		if (j == 0)
+		{
+			report_error("Warning: duplicate task '%s' in catalog, keeping the first\n",
+					tasks.items[i].task_name);
+			tasks.items[i].file_count = -1;
+			continue;
+		}
+		names[count++] = tasks.items[i].task_name;
+		file_total += tasks.items[i].file_count;
+	}
+
+	header.magic = CATALOG_MAGIC;
+	header.version = CATALOG_VERSION;
+	header.task_count = count;
+	header.bucket_count = count / 4 + 1;
+	header.slot_count = count + count / 4 + 1;
+	header.source_count = catalog_sources(source, &newest);
+
+	seeds = calloc(header.bucket_count, sizeof(*seeds));
+	slots = calloc(header.slot_count, sizeof(*slots));
+	files = calloc(file_total + 1, sizeof(*files));
+	if (!seeds || !slots || !files)
+		goto done;
+	if (place_keys(names, count, seeds, header.bucket_count, slots, header.slot_count) != 0)
+	{
+		report_error("Could not build a perfect hash for %s\n", source);
+		goto done;
+	}
+
+	file_total = 0;
+	for (i = 0, f = 0; i < tasks.count; i++)
+	{
+		if (tasks.items[i].file_count < 0)
+			continue;
+		records[f].name = pool_add(&pool, tasks.items[i].task_name);
+		records[f].path = pool_add(&pool, tasks.items[i].expected_path);
+		records[f].main = pool_add(&pool, tasks.items[i].main_file);
+		records[f].target = pool_add(&pool, tasks.items[i].target_file);
+		records[f].expected_output = pool_add(&pool, tasks.items[i].expected_output);
+		records[f].rules = pool_add(&pool, tasks.items[i].rules);
+		records[f].files = file_total;
+		records[f].file_count = tasks.items[i].file_count;
+		for (j = 0; j < tasks.items[i].file_count; j++)
+			files[file_total++] = pool_add(&pool, tasks.items[i].expected_files[j]);
+		if (records[f].name == CATALOG_NONE)
+			goto done;
+		f++;
+	}
+
+	header.seeds_offset = sizeof(header);
+	header.slots_offset = header.seeds_offset + header.bucket_count * sizeof(*seeds);
+	header.records_offset = header.slots_offset + header.slot_count * sizeof(*slots);
+	header.files_offset = header.records_offset + count * sizeof(*records);
+	header.pool_offset = header.files_offset + file_total * sizeof(*files);
+	header.file_size = header.pool_offset + pool.len;
+
+	ret = write_index(index_path, &header, seeds, slots, records, files, &pool);
+
+done:
+	TRACE_END("catalog_build");
+	map_free(seen);
+	task_list_free(&tasks);
+	free(names);
+	free(records);
+	free(seeds);
+	free(slots);
+	free(files);
+	free(pool.data);
+	return ret;
+}
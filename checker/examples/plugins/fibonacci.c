@@ -0,0 +1,105 @@
+#include <string.h>
+#include "../../validators/plugin_api.h"
+
+/*
+ * Example validator plugin for the "fibonacci" task, built by
+ * `make plugins` into examples/plugins/fibonacci.so. It is not in the
+ * default plugin directory, so the catalog's "rules" for fibonacci apply
+ * unless it is loaded with --plugins examples/plugins. It only uses the
+ * checker through CheckerHost, so it can be rebuilt and dropped into a
+ * running daemon's plugin directory.
+ */
+
+static const CheckerHost *checker;
+
+static int fibonacci_init(const CheckerHost *host)
+{
+	checker = host;
+	return 0;
+}
+
+/* Sets *@line and *@len to the line at *@pos and moves past it, 0 at the end */
+static int next_line(const char *data, size_t size, size_t *pos, const char **line, size_t *len)
+{
+	const char *end;
+
+	if (*pos >= size)
+		return 0;
+	*line = data + *pos;
+	end = memchr(*line, '\n', size - *pos);
+	*len = end ? (size_t)(end - *line) : size - *pos;
+	*pos += *len + (end ? 1 : 0);
+	if (*len > 0 && (*line)[*len - 1] == '\r')
+		(*len)--;
+	return 1;
+}
+
+static int line_is(const char *line, size_t len, const char *text)
+{
+	return len == strlen(text) && memcmp(line, text, len) == 0;
+}
+
+static int is_blank(const char *line, size_t len)
+{
+	while (len > 0 && (line[len - 1] == ' ' || line[len - 1] == '\t'))
+		len--;
+	return len == 0;
+}
+
+static int validate_fibonacci_file(const char *filepath)
+{
+	const char *data, *line;
+	size_t size, pos = 0, len;
+	int ok = 0;
+
+	data = checker->read_file(filepath, &size);
+	if (!data)
+	{
+		checker->report_error("Error opening file: %s\n", filepath);
+		return 1;
+	}
+
+	if (!next_line(data, size, &pos, &line, &len) || !line_is(line, len, "#!/usr/bin/env python3"))
+		checker->report_error("Error: First line must be '#!/usr/bin/env python3'\n");
+	else if (!next_line(data, size, &pos, &line, &len) || !is_blank(line, len))
+		checker->report_error("Error: Second line must be blank\n");
+	else if (!next_line(data, size, &pos, &line, &len) || len < 14 ||
+			memcmp(line, "def fibonacci(", 14) != 0)
+		checker->report_error("Error: Expected 'def fibonacci(' as function prototype\n");
+	else
+		ok = 1;
+
+	/* The first non-blank line of the body must open a docstring */
+	while (ok && next_line(data, size, &pos, &line, &len))
+	{
+		while (len > 0 && (*line == ' ' || *line == '\t'))
+		{
+			line++;
+			len--;
+		}
+		if (len == 0)
+			continue;
+		if (len < 3 || (memcmp(line, "\"\"\"", 3) != 0 && memcmp(line, "'''", 3) != 0))
+		{
+			checker->report_error("Error: Expected a docstring after 'def fibonacci('\n");
+			ok = 0;
+		}
+		break;
+	}
+
+	if (ok)
+		checker->report_progress(25000, "%s passed fibonacci file checks.\n", filepath);
+	return ok ? 0 : 1;
+}
+
+static const CheckerPluginValidator fibonacci_validators[] = {
+	{ "fibonacci", validate_fibonacci_file },
+	{ NULL, NULL }
+};
+
+const CheckerPlugin checker_plugin = {
+	CHECKER_PLUGIN_ABI,
+	"fibonacci",
+	fibonacci_init,
+	fibonacci_validators
+};
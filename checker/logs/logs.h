@@ -3,6 +3,9 @@
 
 #include "../main/checker.h"
 
-int log_clone_time(const char *username, const char *repo_dir);
+extern long workspace_budget_mb;
+
+int workspace_touch(const char *username, const char *repo_dir, int changed);
+int workspace_prune(long max_idle);
 
 #endif
@@ -0,0 +1,313 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ftw.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "logs.h"
+#include "../utils/utils.h"
+#include "../reporter/reporter.h"
+
+/*
+ * Workspace index: one "user:dir:last_access:size_bytes" line per
+ * cloned_repo_<user>. Every change is a read-modify-write of the whole
+ * file under WORKSPACE_LOCK, written to a temporary file and renamed over
+ * the index so readers never see a partial one. Sizes are measured when a
+ * clone is created or updated, outside that lock, and reused otherwise.
+ */
+
+long workspace_budget_mb = WORKSPACE_BUDGET_MB;
+
+typedef struct {
+	char user[128];
+	char dir[256];
+	long last_access;
+	long size;
+	int busy; /* locked by a running check, not written to the index */
+} Workspace;
+
+typedef struct {
+	Workspace *items;
+	int count;
+	int capacity;
+} WorkspaceIndex;
+
+static long tree_bytes;
+
+static int add_entry_size(const char *path, const struct stat *st, int type, struct FTW *ftw)
+{
+	(void)path;
+	(void)type;
+	(void)ftw;
+	tree_bytes += (long)st->st_blocks * 512;
+	return 0;
+}
+
+/* Disk usage of @dir in bytes, -1 if it does not exist */
+static long workspace_size(const char *dir)
+{
+	tree_bytes = 0;
+	if (nftw(dir, add_entry_size, 32, FTW_PHYS) != 0)
+		return -1;
+	return tree_bytes;
+}
+
+static Workspace *index_add(WorkspaceIndex *index)
+{
+	Workspace *grown;
+
+	if (index->count == index->capacity)
+	{
+		index->capacity = index->capacity ? index->capacity * 2 : 64;
+		grown = realloc(index->items, index->capacity * sizeof(*grown));
+		if (!grown)
+			return NULL;
+		index->items = grown;
+	}
+	memset(&index->items[index->count], 0, sizeof(Workspace));
+	return &index->items[index->count++];
+}
+
+static void index_read(WorkspaceIndex *index)
+{
+	char line[512];
+	Workspace entry;
+	Workspace *slot;
+	FILE *fp;
+
+	fp = fopen(WORKSPACE_INDEX, "r");
+	if (!fp)
+		return;
+	while (fgets(line, sizeof(line), fp))
+	{
+		if (sscanf(line, "%127[^:]:%255[^:]:%ld:%ld", entry.user, entry.dir,
+					&entry.last_access, &entry.size) != 4)
+			continue;
+		entry.busy = 0;
+		/* Drop workspaces that were removed behind our back */
+		if (access(entry.dir, F_OK) != 0)
+			continue;
+		slot = index_add(index);
+		if (!slot)
+			break;
+		*slot = entry;
+	}
+	fclose(fp);
+}
+
+static int index_write(const WorkspaceIndex *index)
+{
+	char tmp[256];
+	FILE *fp;
+	int i, ok;
+
+	snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", WORKSPACE_INDEX, (long)getpid());
+	fp = fopen(tmp, "w");
+	if (!fp)
+		return 1;
+	for (i = 0; i < index->count; i++)
+	{
+		if (index->items[i].dir[0])
+			fprintf(fp, "%s:%s:%ld:%ld\n", index->items[i].user, index->items[i].dir,
+					index->items[i].last_access, index->items[i].size);
+	}
+	ok = !ferror(fp);
+	if (fclose(fp) != 0 || !ok || rename(tmp, WORKSPACE_INDEX) != 0)
+	{
+		unlink(tmp);
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Removes least recently used workspaces until the total fits the budget,
+ * or those idle longer than @max_idle seconds (0 = no age limit). @keep and
+ * workspaces whose repo_lock() another check holds are never evicted.
+ */
+static void evict(WorkspaceIndex *index, const char *keep, long max_idle)
+{
+	long total = 0, budget, now;
+	int i, oldest, fd;
+
+	now = (long)time(NULL);
+	budget = workspace_budget_mb * 1024 * 1024;
+	for (i = 0; i < index->count; i++)
+	{
+		if (index->items[i].dir[0])
+			total += index->items[i].size;
+	}
+
+	for (;;)
+	{
+		oldest = -1;
+		for (i = 0; i < index->count; i++)
+		{
+			if (!index->items[i].dir[0] || index->items[i].busy ||
+					(keep && strcmp(index->items[i].dir, keep) == 0))
+				continue;
+			if (oldest < 0 || index->items[i].last_access < index->items[oldest].last_access)
+				oldest = i;
+		}
+		if (oldest < 0)
+			break;
+		if (!(budget > 0 && total > budget) &&
+				!(max_idle > 0 && now - index->items[oldest].last_access > max_idle))
+			break;
+
+		fd = repo_lock(index->items[oldest].dir, LOCK_EX | LOCK_NB);
+		if (fd < 0)
+		{
+			index->items[oldest].busy = 1;
+			continue;
+		}
+		report_info("Evicting workspace %s (%ld KiB, idle %lds)\n", index->items[oldest].dir,
+				index->items[oldest].size / 1024, now - index->items[oldest].last_access);
+		remove_tree(index->items[oldest].dir);
+		/* Its blobs go with the next store_gc() unless others use them */
+		if (store_forget(index->items[oldest].user) != 0)
+			report_error("Warning: could not release %s's objects in the store.\n",
+					index->items[oldest].user);
+		unlock_path(fd);
+		total -= index->items[oldest].size;
+		index->items[oldest].dir[0] = '\0';
+	}
+}
+
+/**
+ * workspace_touch - Records that a workspace was just used.
+ * @username: Owner of the workspace
+ * @repo_dir: The cloned_repo_<user> directory
+ * @changed: Non-zero if @repo_dir was just cloned or updated
+ *
+ * Refreshes the workspace's last access time in the index, and its size
+ * if it @changed or is not indexed yet, then evicts least recently used
+ * workspaces while the total is over workspace_budget_mb.
+ *
+ * Return: 0 on success, 1 if the index could not be updated
+ */
+int workspace_touch(const char *username, const char *repo_dir, int changed)
+{
+	WorkspaceIndex index;
+	Workspace *entry = NULL;
+	long size = -1;
+	int fd, i, ret;
+
+	/* Walked before taking the index lock, so other checks do not wait on it */
+	if (changed)
+	{
+		size = workspace_size(repo_dir);
+		if (size < 0)
+			return 1;
+	}
+
+	memset(&index, 0, sizeof(index));
+	fd = lock_path(WORKSPACE_LOCK, LOCK_EX);
+	if (fd < 0)
+		return 1;
+
+	index_read(&index);
+	for (i = 0; i < index.count; i++)
+	{
+		if (strcmp(index.items[i].dir, repo_dir) == 0)
+			entry = &index.items[i];
+	}
+	if (!entry)
+	{
+		/* Left empty, and so not written, if the workspace is gone */
+		entry = index_add(&index);
+		if (entry && size < 0)
+			size = workspace_size(repo_dir);
+		if (size < 0)
+			entry = NULL;
+	}
+	if (entry)
+	{
+		snprintf(entry->user, sizeof(entry->user), "%s", username);
+		snprintf(entry->dir, sizeof(entry->dir), "%s", repo_dir);
+		entry->last_access = (long)time(NULL);
+		if (size >= 0)
+			entry->size = size;
+	}
+
+	evict(&index, repo_dir, 0);
+	ret = index_write(&index);
+	unlock_path(fd);
+	free(index.items);
+	return ret;
+}
+
+/*
+ * Removes cloned_repo_<user>.XXXXXX directories that clones which crashed
+ * before rename() left behind. A clone in progress holds its workspace's
+ * repo_lock() exclusive, so directories whose lock is free are stale.
+ */
+static void sweep_partial_clones(void)
+{
+	char base[256];
+	struct dirent *de;
+	const char *dot;
+	struct stat st;
+	DIR *dir;
+	int fd;
+
+	dir = opendir(".");
+	while (dir && (de = readdir(dir)) != NULL)
+	{
+		dot = strrchr(de->d_name, '.');
+		if (strncmp(de->d_name, "cloned_repo_", 12) != 0 || !dot || strlen(dot + 1) != 6 ||
+				(size_t)(dot - de->d_name) >= sizeof(base))
+			continue;
+		if (lstat(de->d_name, &st) != 0 || !S_ISDIR(st.st_mode))
+			continue;
+		snprintf(base, sizeof(base), "%.*s", (int)(dot - de->d_name), de->d_name);
+		fd = repo_lock(base, LOCK_EX | LOCK_NB);
+		if (fd < 0)
+			continue;
+		report_info("Removing partial clone %s\n", de->d_name);
+		remove_tree(de->d_name);
+		unlock_path(fd);
+	}
+	if (dir)
+		closedir(dir);
+}
+
+/**
+ * workspace_prune - Evicts idle workspaces and enforces the disk budget.
+ * @max_idle: Seconds without use after which a workspace is removed
+ *
+ * Partial clones left by crashed checks are removed first.
+ *
+ * Return: 0 on success, 1 if the index could not be updated
+ */
+int workspace_prune(long max_idle)
+{
+	WorkspaceIndex index;
+	long total = 0;
+	int fd, i, ret;
+
+	memset(&index, 0, sizeof(index));
+	fd = lock_path(WORKSPACE_LOCK, LOCK_EX);
+	if (fd < 0)
+		return 1;
+
+	sweep_partial_clones();
+	index_read(&index);
+	evict(&index, NULL, max_idle);
+	for (i = 0; i < index.count; i++)
+	{
+		if (index.items[i].dir[0])
+			total += index.items[i].size;
+	}
+	ret = index_write(&index);
+	unlock_path(fd);
+	free(index.items);
+
+	report_info("Workspaces: %ld MiB in use, budget %ld MiB\n", total / (1024 * 1024),
+			workspace_budget_mb);
+	return ret;
+}
@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "checker.h"
+#include "reporter.h"
+#include "../utils/utils.h"
+
+typedef struct {
+	char *line;
+	const char *repo_url;
+	char **task_names;
+	int task_name_count;
+	int first_status; /* index of the entry's first task in BatchContext.statuses */
+} BatchEntry;
+
+typedef struct {
+	BatchEntry *entries;
+	const Catalog *catalog;
+	int *statuses; /* shared with the workers, one per entry task */
+} BatchContext;
+
+static int parse_entry(char *line, BatchEntry *entry, Arena *arena,
+		char **default_names, int default_count)
+{
+	char *url, *names;
+
+	line[strcspn(line, "\r\n")] = '\0';
+	url = lstrip(line);
+	if (*url == '\0' || *url == '#')
+		return 0;
+
+	names = url + strcspn(url, " \t");
+	if (*names)
+		*names++ = '\0';
+
+	entry->repo_url = url;
+	entry->task_name_count = parse_task_names(names, arena, &entry->task_names, 0);
+	if (entry->task_name_count < 0)
+		return 0;
+	if (entry->task_name_count == 0)
+	{
+		/* The defaults outlive the batch, so entries can share them */
+		entry->task_names = default_names;
+		entry->task_name_count = default_count;
+	}
+
+	return entry->task_name_count > 0;
+}
+
+static BatchEntry *read_manifest(const char *path, Arena *arena, char **default_names,
+		int default_count, int *entry_count)
+{
+	FILE *fp;
+	BatchEntry *entries = NULL, *grown;
+	char buffer[2048];
+	int count = 0, capacity = 0, statuses = 0;
+
+	fp = fopen(path, "r");
+	if (!fp)
+	{
+		report_error("Could not open manifest: %s\n", path);
+		return NULL;
+	}
+
+	while (fgets(buffer, sizeof(buffer), fp))
+	{
+		if (count == capacity)
+		{
+			capacity = capacity ? capacity * 2 : 64;
+			grown = realloc(entries, capacity * sizeof(*entries));
+			if (!grown)
+				break;
+			entries = grown;
+		}
+
+		memset(&entries[count], 0, sizeof(entries[count]));
+		entries[count].line = arena_strdup(arena, buffer);
+		if (!entries[count].line)
+			break;
+
+		if (parse_entry(entries[count].line, &entries[count], arena, default_names, default_count))
+		{
+			entries[count].first_status = statuses;
+			statuses += entries[count].task_name_count;
+			count++;
+		}
+	}
+
+	fclose(fp);
+	*entry_count = count;
+	return entries;
+}
+
+static int check_entry(int index, void *ctx)
+{
+	BatchContext *batch = ctx;
+	BatchEntry *entry = &batch->entries[index];
+	TaskResult *results;
+	CheckerJob job;
+	int result_count = 0, code, i;
+
+	results = malloc(sizeof(*results) * entry->task_name_count);
+	if (!results)
+		return 1;
+
+	memset(&job, 0, sizeof(job));
+	job.repo_url = entry->repo_url;
+	job.task_names = entry->task_names;
+	job.task_name_count = entry->task_name_count;
+	job.jobs = 1;
+
+	code = run_job(&job, batch->catalog, results, &result_count);
+
+	for (i = 0; i < result_count; i++)
+		batch->statuses[entry->first_status + i] = results[i].status;
+
+	free(results);
+	return code;
+}
+
+/**
+ * run_batch - Checks every repository listed in a manifest.
+ * @manifest: File with one "<repo_url> [task1,task2,...]" entry per line
+ * @output: Aggregated result file, one "repo<TAB>task<TAB>status" line per pair
+ * @default_names: Tasks used for entries that do not list their own
+ * @default_count: Number of entries in @default_names
+ * @catalog: Task catalog loaded once for the whole batch
+ * @jobs: Repositories cloned and checked concurrently
+ *
+ * Return: 0 if every task of every repository passed, 1 otherwise
+ */
+int run_batch(const char *manifest, const char *output, char **default_names, int default_count,
+		const Catalog *catalog, int jobs)
+{
+	BatchContext batch;
+	BatchEntry *entries;
+	Arena *arena;
+	FILE *out;
+	size_t shared_size;
+	int *codes;
+	int entry_count = 0, status_count, passed = 0, failed = 0, any_failed = 0;
+	int i, t, status;
+
+	/* Manifest lines and task name vectors, released in one go */
+	arena = arena_create();
+	if (!arena)
+		return 1;
+	entries = read_manifest(manifest, arena, default_names, default_count, &entry_count);
+	if (!entries || entry_count == 0)
+	{
+		if (entries)
+			report_error("No repositories listed in %s\n", manifest);
+		free(entries);
+		arena_destroy(arena);
+		return 1;
+	}
+	status_count = entries[entry_count - 1].first_status + entries[entry_count - 1].task_name_count;
+
+	/* Workers are separate processes, results come back through shared memory */
+	shared_size = sizeof(int) * status_count;
+	batch.statuses = mmap(NULL, shared_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	codes = malloc(sizeof(int) * entry_count);
+	if (batch.statuses == MAP_FAILED || !codes)
+	{
+		report_perror("Batch allocation failed");
+		any_failed = 1;
+		goto cleanup;
+	}
+	for (i = 0; i < status_count; i++)
+		batch.statuses[i] = ERROR;
+
+	batch.entries = entries;
+	batch.catalog = catalog;
+
+	report_info("Batch: %d repositories, %d at a time\n", entry_count, jobs);
+	run_pool(jobs, entry_count, check_entry, &batch, codes);
+
+	out = fopen(output, "w");
+	if (!out)
+	{
+		report_error("Could not write batch results to %s\n", output);
+		any_failed = 1;
+	}
+	else
+	{
+		fprintf(out, "repo\ttask\tstatus\n");
+	}
+
+	for (i = 0; i < entry_count; i++)
+	{
+		for (t = 0; t < entries[i].task_name_count; t++)
+		{
+			status = batch.statuses[entries[i].first_status + t];
+			if (status == SUCCESS)
+				passed++;
+			else
+				failed++;
+			if (out)
+				fprintf(out, "%s\t%s\t%s\n", entries[i].repo_url,
+						entries[i].task_names[t], status_name(status));
+		}
+		if (codes[i] != 0)
+			any_failed = 1;
+	}
+	if (out)
+		fclose(out);
+
+	report_info("\nBatch complete: %d repositories, %d tasks passed, %d failed. Results in %s\n",
+			entry_count, passed, failed, output);
+
+cleanup:
+	if (batch.statuses != MAP_FAILED)
+		munmap(batch.statuses, shared_size);
+	free(codes);
+	free(entries);
+	arena_destroy(arena);
+	return any_failed;
+}
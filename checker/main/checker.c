@@ -4,201 +4,247 @@
 #include <unistd.h>
 #include <ctype.h>
 #include "checker.h"
-#include "typewriter.h"
+#include "reporter.h"
+#include "../trace/trace.h"
+#include "../metrics/metrics.h"
 #include "../logs/logs.h"
 #include "../utils/utils.h"
 #include "../validators/validators.h"
 
+static void usage(const char *prog)
+{
+	report_error("Usage: %s --task-name <name1,name2,...> --repo <url> [--jobs <n>]\n", prog);
+	report_error("       %s --manifest <repos.txt> [--task-name <names>] [--output <file>] [--jobs <n>]\n", prog);
+	report_error("       %s --daemon [--socket <path>] [--jobs <n>]\n", prog);
+	report_error("Output: --format tty|plain|json (default: tty on a terminal, plain otherwise)\n");
+	report_error("        --trace <out.json> writes Chrome trace events for each stage\n");
+	report_error("        --metrics <out.prom> writes Prometheus metrics when the run ends\n");
+	report_error("        --catalog <dir|file> loads tasks from somewhere other than json_tasks\n");
+	report_error("        --plugins <dir> loads validator plugins (*.so) from <dir> (default %s)\n",
+			PLUGIN_DIR);
+	report_error("       %s --gc-cache compacts the object store and prunes cached results\n", prog);
+	report_error("        --no-cache re-checks and re-lints every task even if its files did not change\n");
+	report_error("       %s --prune-workspaces removes clones idle for a day or over budget\n", prog);
+	report_error("        --disk-budget <MiB> caps cloned_repo_* disk use (default %d, 0 = no cap)\n",
+			WORKSPACE_BUDGET_MB);
+}
+
+static void write_metrics_file(const char *path)
+{
+	FILE *fp;
+
+	fp = fopen(path, "w");
+	if (!fp)
+	{
+		report_perror(path);
+		return;
+	}
+	metrics_write(fp);
+	fclose(fp);
+}
+
 int main(int argc, char *argv[])
 {
 	const char *repo_url = NULL;
-	char repo_dir[256];
-	char *task_names[MAX_TASK_NAMES];
-	char main_script_path[1024];
-	char msg[512];
-	char *token, *end, *username;
-	int task_name_count = 0, result;
-	int task_count = 0;
-	int clone_result = 0;
-	int i, j, t, match, any_failed = 0;
-	const char *name;
-	Task tasks[MAX_TASKS];
+	const char *socket_path = DAEMON_SOCKET;
+	const char *catalog_dir = TASKS_DIR;
+	const char *plugin_dir = PLUGIN_DIR;
+	const char *manifest = NULL;
+	const char *output = BATCH_RESULTS;
+	const char *format = NULL;
+	const char *trace_path = NULL;
+	const char *metrics_path = NULL;
+	const char **catalog_names;
+	char **task_names = NULL;
+	TaskResult *results;
+	Arena *arena;
+	CheckerJob job;
+	Catalog catalog;
+	int task_name_count = 0, result_count = 0;
+	int daemon_mode = 0;
+	int gc_cache = 0;
+	int prune_workspaces = 0;
+	int jobs = 1;
+	int i, t, result = 1;
+
+	/* Requested task names and their results, released together at exit */
+	arena = arena_create();
+	if (!arena)
+		return 1;
 
 	for (i = 1; i < argc; i++)
 	{
 		if (strcmp(argv[i], "--task-name") == 0 && i + 1 < argc)
 		{
-			token = strtok(argv[++i], ",");
-			while (token != NULL && task_name_count < MAX_TASK_NAMES)
-			{
-				while (isspace((unsigned char)*token)) token++;
-				end = token + strlen(token) - 1;
-				while (end > token && isspace((unsigned char)*end)) *end-- = '\0';
-				task_names[task_name_count++] = token;
-				token = strtok(NULL, ",");
-			}
+			task_name_count = parse_task_names(argv[++i], arena, &task_names, task_name_count);
+			if (task_name_count < 0)
+				goto done;
 		}
 		else if (strcmp(argv[i], "--repo") == 0 && i + 1 < argc)
 		{
 			repo_url = argv[++i];
 		}
+		else if (strcmp(argv[i], "--daemon") == 0)
+		{
+			daemon_mode = 1;
+		}
+		else if (strcmp(argv[i], "--gc-cache") == 0)
+		{
+			gc_cache = 1;
+		}
+		else if (strcmp(argv[i], "--prune-workspaces") == 0)
+		{
+			prune_workspaces = 1;
+		}
+		else if (strcmp(argv[i], "--disk-budget") == 0 && i + 1 < argc)
+		{
+			workspace_budget_mb = atol(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--no-cache") == 0)
+		{
+			result_cache_enabled = 0;
+		}
+		else if (strcmp(argv[i], "--catalog") == 0 && i + 1 < argc)
+		{
+			catalog_dir = argv[++i];
+		}
+		else if (strcmp(argv[i], "--plugins") == 0 && i + 1 < argc)
+		{
+			plugin_dir = argv[++i];
+		}
+		else if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc)
+		{
+			socket_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--manifest") == 0 && i + 1 < argc)
+		{
+			manifest = argv[++i];
+		}
+		else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+		{
+			output = argv[++i];
+		}
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+		{
+			trace_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc)
+		{
+			metrics_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+		{
+			format = argv[++i];
+		}
+		else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+		{
+			jobs = atoi(argv[++i]);
+			if (jobs < 1)
+				jobs = 1;
+		}
 	}
 
-	if (!repo_url || task_name_count == 0)
+	/* A daemon's jobs never animate, whatever terminal it was started from */
+	if (!format && daemon_mode)
+		format = "plain";
+	if (report_init(format) != 0)
 	{
-		fprintf(stderr, "Usage: %s --task-name <name1,name2,...> --repo <url>\n", argv[0]);
-		return 1;
+		report_error("Unknown output format: %s\n", format);
+		usage(argv[0]);
+		goto done;
 	}
+	atexit(report_flush);
 
-	for (t = 0; t < task_name_count; t++)
+	if (trace_path)
 	{
-		printf("Task to process: %s\n", task_names[t]);
+		if (trace_open(trace_path) != 0)
+		{
+			report_perror(trace_path);
+			goto done;
+		}
+		atexit(trace_close);
 	}
 
-	/* Assign globals for utils access */
-	g_task_names = task_names;
-	g_task_name_count = task_name_count;
-
-	memset(tasks, 0, sizeof(tasks));
-	typewrite(30000, "Starting Checker...\n");
-
-	if (!is_valid_git_url(repo_url))
+	/* Maintenance commands need no catalog and end here */
+	if (gc_cache || prune_workspaces)
 	{
-		fprintf(stderr, "Error: Invalid Git repository URL: '%s'\n", repo_url);
-		return 1;
+		if (!gc_cache)
+		{
+			result = workspace_prune(WORKSPACE_MAX_IDLE) != 0;
+			goto done;
+		}
+		result = store_gc() != 0;
+		report_info("Removed %d cached results.\n", result_cache_prune());
+		goto done;
 	}
 
-	username = extract_username(repo_url);
-	if (!username)
+	if (!daemon_mode && !manifest && (!repo_url || task_name_count == 0))
 	{
-		fprintf(stderr, "Could not extract GitHub username.\n");
-		return 1;
+		usage(argv[0]);
+		goto done;
 	}
-	snprintf(repo_dir, sizeof(repo_dir), "cloned_repo_%s", username);
-	if (access(repo_dir, F_OK) != 0)
+
+	for (t = 0; t < task_name_count; t++)
 	{
-		typewrite(30000, "Cloning repository...\n");
-		clone_result = clone_repo(repo_url, "cloned_repo");
-		if (clone_result != 0)
-		{
-			fprintf(stderr, "Failed to clone the repository.\n");
-			free(username);
-			return 1;
-		}
-		printf("Repository cloned successfully into 'cloned_repo'\n");
-		log_clone_time(username, repo_dir);
+		report_info("Task to process: %s\n", task_names[t]);
+	}
 
-		typewrite(100000, "Renaming repository....\n");
-		if (rename_repo("cloned_repo", repo_dir) != 0)
-		{
-			perror("Rename failed");
-			free(username);
-			return 1;
-		}
+	/* The whole catalog is loaded once, paths stay relative to the repo */
+	TRACE_BEGIN("load_tasks", catalog_dir);
+	result = catalog_load(catalog_dir, &catalog);
+	TRACE_END("load_tasks");
+	if (result != 0)
+	{
+		report_error("Failed to load tasks from JSON.\n");
+		result = 1;
+		goto free_catalog;
 	}
-	else
+	init_registry(plugin_dir);
+	/* Started before any fork so every task and job shares one worker */
+	lint_worker_start();
+	atexit(lint_worker_stop);
+
+	catalog_names = arena_alloc(arena, sizeof(*catalog_names) * catalog.tasks.count);
+	results = arena_alloc(arena, sizeof(*results) * task_name_count);
+	if (!catalog_names || !results)
 	{
-		snprintf(msg, sizeof(msg), "Repository already exists at '%s', updating....\n", repo_dir);
-		typewrite(25000, msg);
-		result = update_repo(repo_dir);
-		if (result != 0)
-		{
-			fprintf(stderr, "Failed to update the repository.\n");
-			return 1;
-		}
-		typewrite(3000, "Repository updated successfully...\n");
-		printf("\n");
-		printf("..............\n");
-		printf("\n");
+		result = 1;
+		goto free_catalog;
 	}
-	free(username);
+	for (i = 0; i < catalog.tasks.count; i++)
+		catalog_names[i] = catalog.tasks.items[i].task_name;
+	if (metrics_init(catalog_names, i) != 0)
+		report_error("Warning: metrics are disabled.\n");
 
-	typewrite(30000, "Loading tasks...\n");
-
-	if (load_tasks("json_tasks", repo_dir, tasks, &task_count) != 0)
+	if (daemon_mode)
 	{
-		fprintf(stderr, "Failed to load tasks from JSON.\n");
-		return 1;
+		result = run_daemon(socket_path, &catalog, jobs);
+		goto free_catalog;
 	}
 
-	for (t = 0; t < task_name_count; t++)
+	if (manifest)
 	{
-		int found = 0;
-		for (i = 0; i < task_count; i++)
-		{
-			if (strcmp(task_names[t], tasks[i].task_name) == 0)
-			{
-				found = 1;
-				break;
-			}
-		}
-		if (!found)
-		{
-			fprintf(stderr, "Warning: Task '%s' not found in tasks.json.\n", task_names[t]);
-		}
+		result = run_batch(manifest, output, task_names, task_name_count, &catalog, jobs);
 	}
-
-	for (i = 0; i < task_count; i++)
+	else
 	{
-		name = tasks[i].task_name ? tasks[i].task_name : "Unnamed";
-		match = 0;
-		for (j = 0; j < task_name_count; j++)
-		{
-			if (strcmp(task_names[j], name) == 0)
-			{
-				match = 1;
-				break;
-			}
-		}
-		if (!match)
-			continue;
-
-		printf("\n");
-		typewrite(30000, "----------------------\n");
-		typewrite(30000, "Checking task: ");
-		typewrite(30000, "%s\n", name);
-
-		printf("Path: %s\n", tasks[i].expected_path);
-		printf("Target: %s\n", tasks[i].target_file);
-		printf("Main file: %s\n", tasks[i].main_file);
-
-		if (!check_task_files(&tasks[i]))
-		{
-			fprintf(stderr, "One or more required files are missing for task '%s'.\n", name);
-			continue;
-		}
-
-		snprintf(main_script_path, sizeof(main_script_path), "%s/%s", tasks[i].expected_path, tasks[i].target_file);
-		if (validate_task(&tasks[i], main_script_path) != 0)
-		{
-			fprintf(stderr, "Validation failed for %s\n", main_script_path);
-			typewrite(25000, "Checker failed due to validation errors.\n");
-			any_failed = 1;
-			continue;
-		}
-
-		snprintf(main_script_path, sizeof(main_script_path), "%s/%s", tasks[i].expected_path, tasks[i].main_file);
-		if (tasks[i].expected_output)
-		{
-			if (check_output(main_script_path, tasks[i].expected_output) != 0)
-			{
-				fprintf(stderr, "Main output check failed for task '%s'.\n", name);
-				typewrite(25000, "Checker failed due to output mismatch.\n");
-				any_failed = 1;
-				continue;
-			}
-		}
-		else
-		{
-			fprintf(stderr, "Missing expected output for task '%s'\n", name);
-		}
+		memset(&job, 0, sizeof(job));
+		job.repo_url = repo_url;
+		job.jobs = jobs;
+		job.task_names = task_names;
+		job.task_name_count = task_name_count;
+
+		TRACE_BEGIN("run_job", repo_url);
+		result = run_job(&job, &catalog, results, &result_count);
+		TRACE_END("run_job");
 	}
 
-	free_tasks(tasks, task_count);
-	if (!any_failed)
-		typewrite(30000, "\nChecker completed successfully.\n");
-	else
-		typewrite(30000, "\nChecker completed with some failures.\n");
+	if (metrics_path)
+		write_metrics_file(metrics_path);
 
-	return any_failed;
+free_catalog:
+	catalog_free(&catalog);
+done:
+	arena_destroy(arena);
+	return result;
 }
@@ -7,11 +7,27 @@
 #include <stddef.h>
 #include <ctype.h>
 
-#define MAX_FILES 10
-#define MAX_TASKS 100
-#define MAX_TASK_NAMES 20
-
 #define LOG_PATH "logs/hashes.log"
+#define TASKS_DIR "json_tasks"
+#define PLUGIN_DIR "plugins"
+#define DAEMON_SOCKET "checker.sock"
+#define BATCH_RESULTS "batch_results.tsv"
+#define DAEMON_JOB_TIMEOUT 30
+#define LINT_WORKER "scripts/lint_worker.py"
+#define LINT_WORKER_TIMEOUT 20
+#define CACHE_DIR "cache"
+#define OBJECT_STORE CACHE_DIR "/objects.git"
+#define OBJECT_STORE_LOCK CACHE_DIR "/objects.lock"
+#define RESULT_CACHE CACHE_DIR "/results"
+#define RESULT_CACHE_LOCK CACHE_DIR "/results.lock"
+#define RESULT_CACHE_BUDGET_MB 256
+#define LINT_CACHE CACHE_DIR "/lint"
+#define LINT_CACHE_LOCK CACHE_DIR "/lint.lock"
+#define LINT_CACHE_BUDGET_MB 64
+#define WORKSPACE_INDEX "logs/workspaces.idx"
+#define WORKSPACE_LOCK "logs/workspaces.lock"
+#define WORKSPACE_BUDGET_MB 1024
+#define WORKSPACE_MAX_IDLE (24 * 60 * 60)
 
 typedef enum {
     SUCCESS = 0,
@@ -19,19 +35,85 @@ typedef enum {
     ERROR   = 2
 } ValidationStatus;
 
+/* Where a task check stopped; validate_task() returns one of these */
+typedef enum {
+	STAGE_NONE = 0,
+	STAGE_FILES,
+	STAGE_README,
+	STAGE_LINT,
+	STAGE_VALIDATOR,
+	STAGE_OUTPUT,
+	STAGE_COUNT
+} CheckStage;
+
+/* Task strings are owned by the TaskList (or catalog index) holding the task */
 typedef struct {
-	char *task_name;
-	char *expected_path;
-	char *main_file;
-	char *target_file;
-	char *expected_output;
-	char *expected_files[10];
+	const char *task_name;
+	const char *expected_path;
+	const char *main_file;
+	const char *target_file;
+	const char *expected_output;
+	const char *rules;          /* catalog "rules" object as JSON text, NULL if none */
+	const char **expected_files;
 	int file_count;
-	char *username;
+	const char *username;
 } Task;
 
+typedef struct Arena Arena;
+typedef struct HashMap HashMap;
+
+/* Growable task vector; the tasks and their strings live in @arena */
+typedef struct {
+	Task *items;
+	int count;
+	int capacity;
+	Arena *arena;
+} TaskList;
+
+/*
+ * The task catalog, loaded once per process. Task strings point into the
+ * mapped catalog index when @index is set (see catalog/), or are interned
+ * in the list's arena straight from the JSON when it could not be built;
+ * @by_name then maps each name to its position in @tasks.
+ */
+typedef struct CatalogIndex CatalogIndex;
+
+typedef struct {
+	TaskList tasks;
+	CatalogIndex *index;
+	HashMap *by_name;
+} Catalog;
+
+typedef struct {
+	const char *repo_url;
+	char **task_names;
+	int task_name_count;
+	int jobs;
+} CheckerJob;
+
+typedef struct {
+	const char *task_name;
+	ValidationStatus status;
+} TaskResult;
+
+typedef int (*PoolFn)(int index, void *ctx);
+
 char *lstrip(char *str);
-int filter_tasks(Task *tasks, int task_count, const char *filter_names,
-                 Task *filtered, int *filtered_count);
+int parse_task_names(char *list, Arena *arena, char ***names, int count);
+int select_tasks(const Catalog *catalog, char **names, int name_count,
+                 const char *repo_dir, TaskList *selected);
+
+int catalog_load(const char *source, Catalog *catalog);
+int catalog_find(const Catalog *catalog, const char *name);
+void catalog_free(Catalog *catalog);
+
+const char *status_name(ValidationStatus status);
+const char *stage_name(int stage);
+int run_job(const CheckerJob *job, const Catalog *catalog,
+            TaskResult *results, int *result_count);
+int run_daemon(const char *socket_path, const Catalog *catalog, int jobs);
+int run_pool(int jobs, int count, PoolFn fn, void *ctx, int *statuses);
+int run_batch(const char *manifest, const char *output, char **default_names, int default_count,
+              const Catalog *catalog, int jobs);
 
 #endif
@@ -0,0 +1,348 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "checker.h"
+#include "reporter.h"
+#include "../metrics/metrics.h"
+#include "../utils/utils.h"
+#include "../validators/validators.h"
+
+#define REQUEST_MAX 4096
+
+/*
+ * Protocol, one job per connection:
+ *
+ *   request:  CHECK <repo_url> <task1,task2,...>\n   or   PING\n   or   METRICS\n
+ *   response: EXIT <code>\n
+ *             TASK <name> <passed|failed|error>\n   (one per requested task)
+ *             STDOUT <bytes>\n<bytes>
+ *             STDERR <bytes>\n<bytes>
+ *             END\n
+ *
+ * METRICS answers with the Prometheus text exposition and closes.
+ */
+
+static int write_all(int fd, const char *buf, size_t len)
+{
+	ssize_t n;
+
+	while (len > 0)
+	{
+		n = write(fd, buf, len);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		buf += n;
+		len -= n;
+	}
+	return 0;
+}
+
+static int write_line(int fd, const char *format, ...)
+{
+	char line[512];
+	va_list args;
+	int len;
+
+	va_start(args, format);
+	len = vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	if (len < 0)
+		return -1;
+	if ((size_t)len >= sizeof(line))
+		len = sizeof(line) - 1;
+
+	return write_all(fd, line, len);
+}
+
+static int read_request(int fd, char *buf, size_t size)
+{
+	size_t used = 0;
+	ssize_t n;
+	char *newline;
+
+	while (used < size - 1)
+	{
+		n = read(fd, buf + used, size - 1 - used);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		used += n;
+		buf[used] = '\0';
+		newline = strchr(buf, '\n');
+		if (newline)
+		{
+			*newline = '\0';
+			if (newline > buf && newline[-1] == '\r')
+				newline[-1] = '\0';
+			return 0;
+		}
+	}
+	return -1;
+}
+
+static int copy_to_socket(int fd, FILE *stream)
+{
+	char buffer[4096];
+	size_t n;
+
+	while ((n = fread(buffer, 1, sizeof(buffer), stream)) > 0)
+	{
+		if (write_all(fd, buffer, n) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+/* Send a captured stream back as "<label> <bytes>\n<bytes>" */
+static int send_stream(int fd, const char *label, FILE *stream)
+{
+	long size;
+
+	fflush(stream);
+	size = ftell(stream);
+	if (size < 0)
+		size = 0;
+	if (write_line(fd, "%s %ld\n", label, size) != 0)
+		return -1;
+
+	rewind(stream);
+	return copy_to_socket(fd, stream);
+}
+
+static void handle_job(int fd, char *args, const Catalog *catalog, int jobs)
+{
+	char **task_names = NULL;
+	TaskResult *results;
+	Arena *arena;
+	CheckerJob job;
+	FILE *out, *err;
+	char *repo_url, *names;
+	int result_count = 0, code, i;
+
+	repo_url = args;
+	names = strchr(args, ' ');
+	if (names)
+		*names++ = '\0';
+
+	/* The job runs in its own child, which exits after replying */
+	arena = arena_create();
+	if (!arena)
+	{
+		write_line(fd, "ERROR out of memory\n");
+		return;
+	}
+
+	memset(&job, 0, sizeof(job));
+	job.repo_url = repo_url;
+	job.jobs = jobs;
+	job.task_name_count = names ? parse_task_names(names, arena, &task_names, 0) : 0;
+	job.task_names = task_names;
+
+	if (!*repo_url || job.task_name_count <= 0)
+	{
+		write_line(fd, "ERROR usage: CHECK <repo_url> <task1,task2,...>\n");
+		arena_destroy(arena);
+		return;
+	}
+
+	results = arena_alloc(arena, sizeof(*results) * job.task_name_count);
+
+	out = tmpfile();
+	err = tmpfile();
+	if (!out || !err || !results)
+	{
+		write_line(fd, "ERROR could not capture job output\n");
+		arena_destroy(arena);
+		return;
+	}
+
+	/* Everything the job prints is captured and returned to the client */
+	report_flush();
+	fflush(stdout);
+	fflush(stderr);
+	dup2(fileno(out), STDOUT_FILENO);
+	dup2(fileno(err), STDERR_FILENO);
+
+	metrics_in_flight(1);
+	setpgid(0, 0);
+	alarm(DAEMON_JOB_TIMEOUT);
+	code = run_job(&job, catalog, results, &result_count);
+	alarm(0);
+	metrics_in_flight(-1);
+
+	report_flush();
+	fflush(stdout);
+	fflush(stderr);
+
+	write_line(fd, "EXIT %d\n", code);
+	for (i = 0; i < result_count; i++)
+		write_line(fd, "TASK %s %s\n", results[i].task_name, status_name(results[i].status));
+	send_stream(fd, "STDOUT", out);
+	send_stream(fd, "STDERR", err);
+	write_line(fd, "END\n");
+
+	fclose(out);
+	fclose(err);
+	arena_destroy(arena);
+}
+
+static void send_metrics(int fd)
+{
+	FILE *text;
+
+	text = tmpfile();
+	if (!text)
+		return;
+	metrics_write(text);
+	fflush(text);
+	rewind(text);
+	copy_to_socket(fd, text);
+	fclose(text);
+}
+
+static void handle_client(int fd, const Catalog *catalog, int jobs)
+{
+	char request[REQUEST_MAX];
+
+	if (read_request(fd, request, sizeof(request)) != 0)
+	{
+		write_line(fd, "ERROR malformed request\n");
+		return;
+	}
+
+	if (strcmp(request, "PING") == 0)
+		write_line(fd, "PONG\n");
+	else if (strcmp(request, "METRICS") == 0)
+		send_metrics(fd);
+	else if (strncmp(request, "CHECK ", 6) == 0)
+		handle_job(fd, request + 6, catalog, jobs);
+	else
+		write_line(fd, "ERROR unknown command\n");
+}
+
+/*
+ * A job that outlives DAEMON_JOB_TIMEOUT is killed by its own alarm; one
+ * that crashes (SIGSEGV, abort, the OOM killer) dies before lowering the
+ * in-flight gauge just the same. Either way its process group (git,
+ * linters, the student's program) goes with it and the job is counted.
+ */
+static void reap_children(int sig)
+{
+	int saved_errno = errno;
+	int status;
+	pid_t pid;
+
+	(void)sig;
+	while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+	{
+		if (!WIFSIGNALED(status))
+			continue;
+		kill(-pid, SIGKILL);
+		metrics_job(WTERMSIG(status) == SIGALRM ? JOB_TIMED_OUT : JOB_FAILED);
+		metrics_in_flight(-1);
+	}
+	errno = saved_errno;
+}
+
+/**
+ * run_daemon - Serves check jobs over a Unix socket until killed.
+ * @socket_path: Filesystem path of the listening socket
+ * @catalog: Task catalog loaded once at startup
+ * @jobs: Tasks checked concurrently within one job
+ *
+ * Each connection is handled in a forked child so the warm catalog and
+ * validator registry are shared copy-on-write, and a crashing job cannot
+ * take the daemon down. The plugin directory is rescanned and the lint
+ * worker restarted if it died before each fork.
+ *
+ * Return: 1 if the socket could not be set up, otherwise does not return
+ */
+int run_daemon(const char *socket_path, const Catalog *catalog, int jobs)
+{
+	struct sockaddr_un addr;
+	struct sigaction sa;
+	int listen_fd, client_fd;
+	pid_t pid;
+
+	if (strlen(socket_path) >= sizeof(addr.sun_path))
+	{
+		report_error("Socket path too long: %s\n", socket_path);
+		return 1;
+	}
+
+	listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listen_fd < 0)
+	{
+		report_perror("socket");
+		return 1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, socket_path);
+	unlink(socket_path);
+
+	if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+			listen(listen_fd, 64) != 0)
+	{
+		report_perror("bind");
+		close(listen_fd);
+		return 1;
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = reap_children;
+	sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGCHLD, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	report_info("Checker daemon listening on %s (%d tasks loaded)\n", socket_path, catalog->tasks.count);
+	report_flush();
+
+	for (;;)
+	{
+		client_fd = accept(listen_fd, NULL, NULL);
+		if (client_fd < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			report_perror("accept");
+			continue;
+		}
+
+		/* New or replaced plugins apply from the next job, no restart needed */
+		if (plugins_rescan())
+			report_flush();
+		/* A lint worker that died is replaced before the job needs it */
+		lint_worker_start();
+
+		pid = fork();
+		if (pid == 0)
+		{
+			close(listen_fd);
+			/* popen()/system() in the job need the default child handling */
+			signal(SIGCHLD, SIG_DFL);
+			handle_client(client_fd, catalog, jobs);
+			close(client_fd);
+			_exit(0);
+		}
+		if (pid < 0)
+			report_perror("fork");
+		close(client_fd);
+	}
+
+	return 0;
+}
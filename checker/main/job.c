@@ -0,0 +1,471 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include "checker.h"
+#include "reporter.h"
+#include "../trace/trace.h"
+#include "../metrics/metrics.h"
+#include "../logs/logs.h"
+#include "../utils/utils.h"
+#include "../validators/validators.h"
+#include "../validators/linters/linters.h"
+
+/* What check_task() gets for each task of a job */
+typedef struct {
+	Task *tasks;
+	char (*keys)[RESULT_KEY_LENGTH]; /* result cache keys, "" when not cacheable */
+} JobContext;
+
+const char *status_name(ValidationStatus status)
+{
+	switch (status)
+	{
+	case SUCCESS:
+		return "passed";
+	case FAILED:
+		return "failed";
+	default:
+		return "error";
+	}
+}
+
+const char *stage_name(int stage)
+{
+	switch (stage)
+	{
+	case STAGE_FILES:
+		return "missing_files";
+	case STAGE_README:
+		return "readme";
+	case STAGE_LINT:
+		return "lint";
+	case STAGE_VALIDATOR:
+		return "validator";
+	case STAGE_OUTPUT:
+		return "output_mismatch";
+	default:
+		return "none";
+	}
+}
+
+/* Clones into a private temporary directory, then publishes it with rename() */
+static int clone_workspace(const char *repo_url, const char *username, const char *repo_dir,
+		const char **paths, int path_count)
+{
+	char clone_dir[300];
+
+	snprintf(clone_dir, sizeof(clone_dir), "%s.XXXXXX", repo_dir);
+	if (!mkdtemp(clone_dir))
+	{
+		report_perror("mkdtemp");
+		return 1;
+	}
+
+	report_progress(30000, "Cloning repository...\n");
+	if (clone_repo(repo_url, clone_dir, username, paths, path_count) != 0)
+	{
+		report_error("Failed to clone the repository.\n");
+		remove_tree(clone_dir);
+		return 1;
+	}
+	report_info("Repository cloned successfully into '%s'\n", clone_dir);
+
+	report_progress(100000, "Renaming repository....\n");
+	if (rename_repo(clone_dir, repo_dir) != 0)
+	{
+		remove_tree(clone_dir);
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Leaves @repo_dir checked out and up to date, and returns its repo_lock()
+ * held shared in @lock so the checkout cannot change under the checks. A
+ * current clone is only ever locked shared, so concurrent checks of the same
+ * student run in parallel; cloning and updating take the lock exclusive.
+ */
+static int prepare_repo(const char *repo_url, const char **paths, int path_count,
+		char *repo_dir, size_t size, int *lock)
+{
+	RemoteHead remote;
+	char msg[512];
+	char *username;
+	int ret = 0, changed = 0;
+
+	*lock = -1;
+	*remote.sha = '\0';
+	if (!is_valid_git_url(repo_url))
+	{
+		report_error("Error: Invalid Git repository URL: '%s'\n", repo_url);
+		return 1;
+	}
+
+	username = extract_username(repo_url);
+	if (!username)
+	{
+		report_error("Could not extract GitHub username.\n");
+		return 1;
+	}
+	snprintf(repo_dir, size, "cloned_repo_%s", username);
+
+	*lock = repo_lock(repo_dir, LOCK_SH);
+	if (*lock < 0 || access(repo_dir, F_OK) != 0 || !repo_is_current(repo_dir, paths, path_count, &remote))
+	{
+		unlock_path(*lock);
+		TRACE_BEGIN("repo_lock_wait", repo_dir);
+		*lock = repo_lock(repo_dir, LOCK_EX);
+		TRACE_END("repo_lock_wait");
+		if (*lock < 0)
+		{
+			report_perror("Could not lock the repository");
+			free(username);
+			return 1;
+		}
+
+		if (access(repo_dir, F_OK) != 0)
+		{
+			ret = clone_workspace(repo_url, username, repo_dir, paths, path_count);
+		}
+		else
+		{
+			snprintf(msg, sizeof(msg), "Repository already exists at '%s', updating....\n", repo_dir);
+			report_progress(25000, "%s", msg);
+			ret = update_repo(repo_dir, paths, path_count, &remote);
+			if (ret != 0)
+			{
+				report_error("Failed to update the repository.\n");
+			}
+			else
+			{
+				report_progress(3000, "Repository updated successfully...\n");
+				report_info("\n");
+				report_info("..............\n");
+				report_info("\n");
+			}
+		}
+		/*
+		 * Back to shared for the checks; flock() converts in place, and
+		 * if it cannot the lock is dropped and taken again shared.
+		 */
+		if (ret == 0 && flock(*lock, LOCK_SH) != 0)
+		{
+			unlock_path(*lock);
+			*lock = repo_lock(repo_dir, LOCK_SH);
+			if (*lock < 0)
+			{
+				report_perror("Could not lock the repository");
+				ret = 1;
+			}
+		}
+		changed = 1;
+	}
+	else
+	{
+		report_progress(25000, "Repository at '%s' is up to date.\n", repo_dir);
+	}
+
+	if (ret == 0 && workspace_touch(username, repo_dir, changed) != 0)
+		report_error("Warning: could not update the workspace index.\n");
+
+	free(username);
+	if (ret != 0)
+	{
+		unlock_path(*lock);
+		*lock = -1;
+	}
+	return ret;
+}
+
+static int run_task_checks(Task *task, int *failed_stage)
+{
+	char script_path[1024];
+	const char *name;
+	int files_ok, stage;
+
+	name = task->task_name ? task->task_name : "Unnamed";
+	report_task(name, "start", task->expected_path);
+	metrics_task_started(name);
+	report_info("\n");
+	report_progress(30000, "----------------------\n");
+	report_progress(30000, "Checking task: ");
+	report_progress(30000, "%s\n", name);
+
+	report_info("Path: %s\n", task->expected_path);
+	report_info("Target: %s\n", task->target_file);
+	report_info("Main file: %s\n", task->main_file);
+
+	TRACE_BEGIN("check_files", name);
+	files_ok = check_task_files(task);
+	TRACE_END("check_files");
+	if (!files_ok)
+	{
+		report_error("One or more required files are missing for task '%s'.\n", name);
+		report_task(name, "failed", stage_name(STAGE_FILES));
+		metrics_task_failed(name, STAGE_FILES);
+		*failed_stage = STAGE_FILES;
+		return FAILED;
+	}
+
+	snprintf(script_path, sizeof(script_path), "%s/%s", task->expected_path, task->target_file);
+	stage = validate_task(task, script_path);
+	if (stage != STAGE_NONE)
+	{
+		report_error("Validation failed for %s\n", script_path);
+		report_progress(25000, "Checker failed due to validation errors.\n");
+		report_task(name, "failed", stage_name(stage));
+		metrics_task_failed(name, stage);
+		*failed_stage = stage;
+		return FAILED;
+	}
+
+	snprintf(script_path, sizeof(script_path), "%s/%s", task->expected_path, task->main_file);
+	if (task->expected_output)
+	{
+		if (check_output(script_path, task->expected_output) != 0)
+		{
+			report_error("Main output check failed for task '%s'.\n", name);
+			report_progress(25000, "Checker failed due to output mismatch.\n");
+			report_task(name, "failed", stage_name(STAGE_OUTPUT));
+			metrics_task_failed(name, STAGE_OUTPUT);
+			*failed_stage = STAGE_OUTPUT;
+			return FAILED;
+		}
+	}
+	else
+	{
+		report_error("Missing expected output for task '%s'\n", name);
+	}
+
+	report_task(name, "passed", NULL);
+	metrics_task_passed(name);
+	*failed_stage = STAGE_NONE;
+	return SUCCESS;
+}
+
+/* Replays a stored result as if the checks had just run, -1 on a miss */
+static int replay_task_checks(Task *task, const char *key)
+{
+	const char *name;
+	FILE *fp;
+	int status, stage;
+
+	fp = result_cache_open(key, &status, &stage);
+	if (!fp)
+		return -1;
+
+	name = task->task_name ? task->task_name : "Unnamed";
+	report_task(name, "start", task->expected_path);
+	metrics_task_started(name);
+	report_replay(fp);
+	fclose(fp);
+	report_info("(%s is unchanged since it was last checked, result reused)\n", name);
+
+	if (status == SUCCESS)
+	{
+		report_task(name, "passed", NULL);
+		metrics_task_passed(name);
+	}
+	else
+	{
+		report_task(name, "failed", stage_name(stage));
+		metrics_task_failed(name, stage);
+	}
+	return status;
+}
+
+static int check_task(int index, void *arg)
+{
+	JobContext *ctx = arg;
+	Task *task = &ctx->tasks[index];
+	const char *key = ctx->keys[index];
+	FILE *record = NULL;
+	int status, stage = STAGE_NONE;
+
+	TRACE_BEGIN("check_task", task->task_name);
+	TRACE_BEGIN("result_cache", task->task_name);
+	status = -1;
+	if (key[0])
+	{
+		status = replay_task_checks(task, key);
+		if (status < 0)
+			record = tmpfile();
+	}
+	TRACE_END("result_cache");
+
+	if (status < 0)
+	{
+		report_record(record);
+		status = run_task_checks(task, &stage);
+		report_record(NULL);
+		if (record)
+		{
+			if (status != ERROR)
+				result_cache_store(key, record, status, stage);
+			fclose(record);
+		}
+	}
+	TRACE_END("check_task");
+	return status;
+}
+
+/*
+ * Computes every task's result cache key and lints, in one batch, the
+ * targets of the tasks whose result is not cached already
+ */
+static int prepare_checks(TaskList *tasks, const char *repo_dir, JobContext *ctx)
+{
+	char path[1024];
+	const char **targets;
+	CachedFile *file;
+	FILE *fp;
+	int i, status, stage, count = 0;
+
+	ctx->tasks = tasks->items;
+	ctx->keys = arena_alloc(tasks->arena, sizeof(*ctx->keys) * (tasks->count + 1));
+	targets = arena_alloc(tasks->arena, sizeof(*targets) * (tasks->count + 1));
+	if (!ctx->keys || !targets)
+		return 1;
+	for (i = 0; i < tasks->count; i++)
+	{
+		ctx->keys[i][0] = '\0';
+		if (result_cache_key(&tasks->items[i], ctx->keys[i]) != 0)
+			ctx->keys[i][0] = '\0';
+		else if ((fp = result_cache_open(ctx->keys[i], &status, &stage)) != NULL)
+		{
+			fclose(fp);
+			continue;
+		}
+		if (!tasks->items[i].target_file)
+			continue;
+		snprintf(path, sizeof(path), "%s/%s", tasks->items[i].expected_path,
+				tasks->items[i].target_file);
+		file = file_cache_stat(path);
+		if (file && !file->is_dir)
+			targets[count++] = arena_strdup(tasks->arena, path);
+	}
+
+	TRACE_BEGIN("lint_batch", repo_dir);
+	lint_prepare(targets, count);
+	TRACE_END("lint_batch");
+	return 0;
+}
+
+/**
+ * run_job - Clones or updates one repository and checks the requested tasks.
+ * @job: Repository URL and task names to check
+ * @catalog: Task catalog with repository-relative paths
+ * @results: Output array with room for job->task_name_count entries
+ * @result_count: Pointer to store how many results were written
+ *
+ * Return: 0 if every task passed, 1 otherwise
+ */
+int run_job(const CheckerJob *job, const Catalog *catalog,
+		TaskResult *results, int *result_count)
+{
+	char repo_dir[256];
+	const char **paths;
+	HashMap *checked;
+	JobContext ctx;
+	TaskList tasks;
+	int *statuses, *status;
+	int path_count = 0;
+	int i, t, result, lock, any_failed = 0;
+
+	*result_count = 0;
+	/* Everything this run allocates lives in the task list's arena */
+	if (task_list_init(&tasks) != 0)
+		return 1;
+	paths = arena_alloc(tasks.arena, sizeof(*paths) * job->task_name_count);
+	statuses = arena_alloc(tasks.arena, sizeof(*statuses) * job->task_name_count);
+	if (!paths || !statuses)
+	{
+		task_list_free(&tasks);
+		return 1;
+	}
+	for (t = 0; t < job->task_name_count; t++)
+	{
+		results[t].task_name = job->task_names[t];
+		results[t].status = ERROR;
+		i = catalog_find(catalog, job->task_names[t]);
+		if (i < 0)
+			report_error("Warning: Task '%s' not found in tasks.json.\n", job->task_names[t]);
+		else if (catalog->tasks.items[i].expected_path)
+			paths[path_count++] = catalog->tasks.items[i].expected_path;
+	}
+	*result_count = job->task_name_count;
+
+	report_progress(30000, "Starting Checker...\n");
+	metrics_job(JOB_STARTED);
+
+	TRACE_BEGIN("prepare_repo", job->repo_url);
+	result = prepare_repo(job->repo_url, paths, path_count, repo_dir, sizeof(repo_dir), &lock);
+	TRACE_END("prepare_repo");
+	if (result != 0)
+	{
+		task_list_free(&tasks);
+		metrics_job(JOB_FAILED);
+		return 1;
+	}
+
+	report_progress(30000, "Loading tasks...\n");
+
+	if (select_tasks(catalog, job->task_names, job->task_name_count, repo_dir, &tasks) != 0)
+	{
+		report_error("Failed to load tasks from JSON.\n");
+		task_list_free(&tasks);
+		unlock_path(lock);
+		metrics_job(JOB_FAILED);
+		return 1;
+	}
+
+	for (i = 0; i < tasks.count; i++)
+	{
+		report_progress(20000, "Loaded Task %d: name=%s path=%s target=%s\n", i + 1,
+				tasks.items[i].task_name, tasks.items[i].expected_path, tasks.items[i].target_file);
+	}
+
+	if (prepare_checks(&tasks, repo_dir, &ctx) != 0)
+	{
+		task_list_free(&tasks);
+		unlock_path(lock);
+		metrics_job(JOB_FAILED);
+		return 1;
+	}
+	if (run_pool(job->jobs, tasks.count, check_task, &ctx, statuses) != 0)
+		report_error("Some tasks could not be started.\n");
+	/* Tasks run inline share the parent's caches; forked ones drop theirs on exit */
+	file_cache_clear();
+	lint_clear();
+
+	/* Repeated names all report the status of the one run of their task */
+	checked = map_create(sizeof(int), tasks.arena);
+	for (i = 0; checked && i < tasks.count; i++)
+	{
+		status = map_put(checked, tasks.items[i].task_name, NULL);
+		if (status)
+			*status = statuses[i];
+	}
+
+	for (t = 0; t < job->task_name_count; t++)
+	{
+		status = checked ? map_get(checked, job->task_names[t]) : NULL;
+		if (status)
+			results[t].status = *status == SUCCESS ? SUCCESS : *status == FAILED ? FAILED : ERROR;
+		if (results[t].status != SUCCESS)
+			any_failed = 1;
+	}
+	map_free(checked);
+
+	task_list_free(&tasks);
+	unlock_path(lock);
+	metrics_job(any_failed ? JOB_FAILED : JOB_PASSED);
+	if (!any_failed)
+		report_progress(30000, "\nChecker completed successfully.\n");
+	else
+		report_progress(30000, "\nChecker completed with some failures.\n");
+
+	return any_failed;
+}
@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "checker.h"
+#include "reporter.h"
+
+typedef struct {
+	pid_t pid;
+	FILE *out;
+	FILE *err;
+	int done;
+} PoolSlot;
+
+static void copy_stream(FILE *from, FILE *to)
+{
+	char buffer[4096];
+	size_t n;
+
+	if (!from)
+		return;
+	fflush(from);
+	rewind(from);
+	while ((n = fread(buffer, 1, sizeof(buffer), from)) > 0)
+		fwrite(buffer, 1, n, to);
+	fflush(to);
+}
+
+/* Print every finished item that has no unfinished item before it */
+static int flush_ready(PoolSlot *slots, int count, int next)
+{
+	report_flush();
+	while (next < count && slots[next].done)
+	{
+		copy_stream(slots[next].out, stdout);
+		copy_stream(slots[next].err, stderr);
+		if (slots[next].out)
+			fclose(slots[next].out);
+		if (slots[next].err)
+			fclose(slots[next].err);
+		slots[next].out = slots[next].err = NULL;
+		next++;
+	}
+	return next;
+}
+
+static int spawn_item(PoolSlot *slot, int index, PoolFn fn, void *ctx)
+{
+	int status;
+
+	slot->out = tmpfile();
+	slot->err = tmpfile();
+	if (!slot->out || !slot->err)
+	{
+		report_perror("tmpfile");
+		return -1;
+	}
+
+	report_flush();
+	fflush(stdout);
+	fflush(stderr);
+	slot->pid = fork();
+	if (slot->pid < 0)
+	{
+		report_perror("fork");
+		return -1;
+	}
+
+	if (slot->pid == 0)
+	{
+		dup2(fileno(slot->out), STDOUT_FILENO);
+		dup2(fileno(slot->err), STDERR_FILENO);
+		status = fn(index, ctx);
+		report_flush();
+		fflush(stdout);
+		fflush(stderr);
+		_exit(status & 0xff);
+	}
+
+	return 0;
+}
+
+/**
+ * run_pool - Runs @count work items in up to @jobs child processes.
+ * @jobs: Maximum number of items running at once
+ * @count: Number of work items
+ * @fn: Called in the child with the item index, its return is the status
+ * @ctx: Passed through to @fn
+ * @statuses: Output array receiving each item's status
+ *
+ * Each child's stdout/stderr is captured and replayed in item order as soon
+ * as every earlier item has finished, so reports never interleave. With a
+ * single job the items run inline in the calling process.
+ *
+ * Return: 0 on success, -1 if a worker could not be started
+ */
+int run_pool(int jobs, int count, PoolFn fn, void *ctx, int *statuses)
+{
+	PoolSlot *slots;
+	int started = 0, running = 0, printed = 0;
+	int i, wstatus, ret = 0;
+	pid_t pid;
+
+	if (jobs <= 1 || count <= 1)
+	{
+		for (i = 0; i < count; i++)
+			statuses[i] = fn(i, ctx);
+		return 0;
+	}
+
+	slots = calloc(count, sizeof(*slots));
+	if (!slots)
+		return -1;
+
+	while (printed < count)
+	{
+		while (running < jobs && started < count)
+		{
+			if (spawn_item(&slots[started], started, fn, ctx) != 0)
+			{
+				statuses[started] = ERROR;
+				slots[started].done = 1;
+				ret = -1;
+			}
+			else
+			{
+				running++;
+			}
+			started++;
+		}
+
+		if (running > 0)
+		{
+			pid = waitpid(-1, &wstatus, 0);
+			if (pid < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				report_perror("waitpid");
+				ret = -1;
+				break;
+			}
+			for (i = 0; i < started; i++)
+			{
+				if (slots[i].pid == pid && !slots[i].done)
+				{
+					statuses[i] = WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : ERROR;
+					slots[i].done = 1;
+					running--;
+					break;
+				}
+			}
+		}
+
+		printed = flush_ready(slots, count, printed);
+	}
+
+	for (i = printed; i < count; i++)
+	{
+		if (slots[i].out)
+			fclose(slots[i].out);
+		if (slots[i].err)
+			fclose(slots[i].err);
+	}
+	free(slots);
+	return ret;
+}
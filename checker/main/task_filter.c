@@ -2,42 +2,100 @@
 #include <string.h>
 #include <stdlib.h>
 #include "checker.h"
+#include "../utils/utils.h"
+
+/* Left-strip whitespace from a string */
+char *lstrip(char *str)
+{
+	while (*str == ' ' || *str == '\t')
+		str++;
+	return str;
+}
 
 /**
- * filter_tasks - Filters tasks based on a comma-separated list of names.
- * @tasks: Full list of tasks loaded from JSON
- * @task_count: Total number of tasks in the list
- * @filter_names: Comma-separated string of task names (e.g. "recursion,factorial")
- * @filtered: Output array for filtered tasks
- * @filtered_count: Pointer to store how many tasks matched
+ * parse_task_names - Splits a comma-separated task list in place.
+ * @list: Mutable string such as "recursion, factorial"
+ * @arena: Arena the name vector grows in
+ * @names: Vector of pointers into @list, appended to and moved as it grows
+ * @count: Number of names already in *@names
  *
- * Return: 0 on success, -1 if none matched
+ * Return: new number of names, -1 on allocation failure
  */
-int filter_tasks(Task *tasks, int task_count, const char *filter_names,
-		Task *filtered, int *filtered_count)
+int parse_task_names(char *list, Arena *arena, char ***names, int count)
 {
-	char names_copy[256];
-	char *token;
-	int i, j = 0;
+	char *token, *end, *saveptr = NULL;
+	char **grown;
+
+	token = strtok_r(list, ",", &saveptr);
+	while (token != NULL)
+	{
+		while (isspace((unsigned char)*token)) token++;
+		end = token + strlen(token) - 1;
+		while (end > token && isspace((unsigned char)*end)) *end-- = '\0';
+		if (*token)
+		{
+			grown = arena_grow(arena, *names, sizeof(char *) * count,
+					sizeof(char *) * (count + 1));
+			if (!grown)
+				return -1;
+			*names = grown;
+			(*names)[count++] = token;
+		}
+		token = strtok_r(NULL, ",", &saveptr);
+	}
 
-	strncpy(names_copy, filter_names, sizeof(names_copy) - 1);
-	names_copy[sizeof(names_copy) - 1] = '\0';
+	return count;
+}
 
-	token = strtok(names_copy, ",");
+/**
+ * select_tasks - Resolves the requested catalog tasks inside a repository.
+ * @catalog: Tasks loaded with paths relative to the repository root
+ * @names: Requested task names, unknown and repeated ones are skipped
+ * @name_count: Number of entries in @names
+ * @repo_dir: Checked-out repository the paths are resolved against
+ * @selected: Initialised list the tasks are appended to
+ *
+ * Only expected_path is built per run; every other string is shared with
+ * the catalog, which outlives the run.
+ *
+ * Return: 0 on success, -1 on allocation failure
+ */
+int select_tasks(const Catalog *catalog, char **names, int name_count,
+		const char *repo_dir, TaskList *selected)
+{
+	char full_path[512];
+	HashMap *seen;
+	const Task *src;
+	Task *dst;
+	int i, j, ret = 0;
 
-	while (token)
+	seen = map_create(0, selected->arena);
+	if (!seen)
+		return -1;
+	for (i = 0; i < name_count && ret == 0; i++)
 	{
-		for (i = 0; i < task_count; i++)
+		j = map_add(seen, names[i]);
+		if (j < 0)
+			ret = -1;
+		j = j > 0 ? catalog_find(catalog, names[i]) : -1;
+		if (j < 0)
+			continue;
+		src = &catalog->tasks.items[j];
+
+		snprintf(full_path, sizeof(full_path), "%s/%s", repo_dir, src->expected_path);
+
+		dst = task_list_add(selected);
+		if (!dst)
 		{
-			if (strcmp(tasks[i].task_name, token) == 0)
-			{
-				filtered[j++] = tasks[i];
-				break;
-			}
+			ret = -1;
+			break;
 		}
-		token = strtok(NULL, ",");
+		*dst = *src;
+		dst->expected_path = arena_intern(selected->arena, full_path);
+		if (!dst->expected_path)
+			ret = -1;
 	}
 
-	*filtered_count = j;
-	return j > 0 ? 0 : -1;
+	map_free(seen);
+	return ret;
 }
@@ -0,0 +1,270 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "metrics.h"
+#include "../main/checker.h"
+#include "../utils/utils.h"
+
+#define METRICS_MAX_TASKS 128
+#define METRICS_NAME_LEN 64
+#define HIST_BUCKETS 13
+
+static const double bucket_bounds[HIST_BUCKETS] = {
+	0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60
+};
+
+static const char *const hist_names[HIST_COUNT] = {
+	"clone", "fetch", "lint", "execution"
+};
+
+static const char *const outcome_names[JOB_OUTCOME_COUNT] = {
+	"started", "passed", "failed", "timed_out"
+};
+
+typedef struct {
+	char name[METRICS_NAME_LEN];
+	long started;
+	long passed;
+	long failed[STAGE_COUNT];
+} TaskCounters;
+
+typedef struct {
+	long buckets[HIST_BUCKETS + 1]; /* last one is +Inf */
+	long sum_us;
+	long count;
+} Histogram;
+
+/*
+ * Lives in one MAP_SHARED page set created before any fork(), so pool
+ * workers, batch entries and daemon jobs all update the same counters.
+ */
+typedef struct {
+	long jobs[JOB_OUTCOME_COUNT];
+	long in_flight;
+	int task_count;
+	TaskCounters tasks[METRICS_MAX_TASKS + 1]; /* last slot collects unknown names */
+	Histogram hist[HIST_COUNT];
+} MetricsState;
+
+static MetricsState *state = NULL;
+static HashMap *task_index = NULL; /* name to slot in state->tasks, read-only after init */
+
+/**
+ * metrics_init - Maps the shared counters and registers the catalog tasks.
+ * @task_names: Names known up front, one counter set each
+ * @task_count: Number of entries in @task_names
+ *
+ * Return: 0 on success, 1 if the shared mapping failed (metrics are then off)
+ */
+int metrics_init(const char **task_names, int task_count)
+{
+	void *mem;
+	int i, *slot;
+
+	mem = mmap(NULL, sizeof(MetricsState), PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (mem == MAP_FAILED)
+		return 1;
+
+	state = mem;
+	memset(state, 0, sizeof(*state));
+	if (task_count > METRICS_MAX_TASKS)
+		task_count = METRICS_MAX_TASKS;
+	for (i = 0; i < task_count; i++)
+	{
+		strncpy(state->tasks[i].name, task_names[i], METRICS_NAME_LEN - 1);
+	}
+	state->task_count = task_count;
+	strcpy(state->tasks[METRICS_MAX_TASKS].name, "unknown");
+
+	task_index = map_create(sizeof(int), NULL);
+	for (i = 0; task_index && i < task_count; i++)
+	{
+		/* Stored one-based so a repeated name keeps its first slot */
+		slot = map_put(task_index, state->tasks[i].name, NULL);
+		if (slot && !*slot)
+			*slot = i + 1;
+	}
+	return 0;
+}
+
+static TaskCounters *task_counters(const char *task_name)
+{
+	int i, *slot;
+
+	if (task_index)
+	{
+		slot = map_get(task_index, task_name);
+		return slot ? &state->tasks[*slot - 1] : &state->tasks[METRICS_MAX_TASKS];
+	}
+	for (i = 0; i < state->task_count; i++)
+	{
+		if (strcmp(state->tasks[i].name, task_name) == 0)
+			return &state->tasks[i];
+	}
+	return &state->tasks[METRICS_MAX_TASKS];
+}
+
+void metrics_job(JobOutcome outcome)
+{
+	if (state)
+		__sync_fetch_and_add(&state->jobs[outcome], 1);
+}
+
+void metrics_in_flight(int delta)
+{
+	if (state)
+		__sync_fetch_and_add(&state->in_flight, delta);
+}
+
+void metrics_task_started(const char *task_name)
+{
+	if (state)
+		__sync_fetch_and_add(&task_counters(task_name)->started, 1);
+}
+
+void metrics_task_passed(const char *task_name)
+{
+	if (state)
+		__sync_fetch_and_add(&task_counters(task_name)->passed, 1);
+}
+
+void metrics_task_failed(const char *task_name, int stage)
+{
+	if (state && stage > STAGE_NONE && stage < STAGE_COUNT)
+		__sync_fetch_and_add(&task_counters(task_name)->failed[stage], 1);
+}
+
+double metrics_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Records the time elapsed since @start, taken from metrics_now() */
+void metrics_observe(StageHistogram hist, double start)
+{
+	Histogram *h;
+	double seconds;
+	int i;
+
+	if (!state)
+		return;
+
+	seconds = metrics_now() - start;
+	h = &state->hist[hist];
+	for (i = 0; i < HIST_BUCKETS && seconds > bucket_bounds[i]; i++)
+		;
+	__sync_fetch_and_add(&h->buckets[i], 1);
+	__sync_fetch_and_add(&h->sum_us, (long)(seconds * 1e6));
+	__sync_fetch_and_add(&h->count, 1);
+}
+
+/* Label values escape backslash, double quote and newline */
+static const char *label_value(const char *value, char *buf, size_t size)
+{
+	size_t n = 0;
+
+	for (; *value && n + 2 < size; value++)
+	{
+		if (*value == '\\' || *value == '"')
+			buf[n++] = '\\';
+		else if (*value == '\n')
+		{
+			buf[n++] = '\\';
+			buf[n++] = 'n';
+			continue;
+		}
+		buf[n++] = *value;
+	}
+	buf[n] = '\0';
+	return buf;
+}
+
+/* Tasks that were never checked are left out to keep the output short */
+static void write_task_totals(FILE *out, const TaskCounters *t)
+{
+	char task[2 * sizeof(t->name)];
+
+	if (t->started == 0)
+		return;
+
+	label_value(t->name, task, sizeof(task));
+	fprintf(out, "checker_tasks_total{task=\"%s\",outcome=\"started\"} %ld\n", task, t->started);
+	fprintf(out, "checker_tasks_total{task=\"%s\",outcome=\"passed\"} %ld\n", task, t->passed);
+}
+
+static void write_task_failures(FILE *out, const TaskCounters *t)
+{
+	char task[2 * sizeof(t->name)], stage_label[64];
+	int stage;
+
+	if (t->started == 0)
+		return;
+
+	label_value(t->name, task, sizeof(task));
+	for (stage = STAGE_NONE + 1; stage < STAGE_COUNT; stage++)
+	{
+		fprintf(out, "checker_task_failures_total{task=\"%s\",stage=\"%s\"} %ld\n", task,
+				label_value(stage_name(stage), stage_label, sizeof(stage_label)), t->failed[stage]);
+	}
+}
+
+/**
+ * metrics_write - Writes all metrics in Prometheus text exposition format.
+ * @out: Destination stream
+ */
+void metrics_write(FILE *out)
+{
+	const Histogram *h;
+	long cumulative;
+	int i, b;
+
+	if (!state)
+		return;
+
+	fprintf(out, "# HELP checker_jobs_total Check jobs by outcome.\n");
+	fprintf(out, "# TYPE checker_jobs_total counter\n");
+	for (i = 0; i < JOB_OUTCOME_COUNT; i++)
+		fprintf(out, "checker_jobs_total{outcome=\"%s\"} %ld\n", outcome_names[i], state->jobs[i]);
+
+	fprintf(out, "# HELP checker_jobs_in_flight Jobs currently being checked.\n");
+	fprintf(out, "# TYPE checker_jobs_in_flight gauge\n");
+	fprintf(out, "checker_jobs_in_flight %ld\n", state->in_flight);
+
+	fprintf(out, "# HELP checker_tasks_total Tasks checked by name and outcome.\n");
+	fprintf(out, "# TYPE checker_tasks_total counter\n");
+	for (i = 0; i < state->task_count; i++)
+		write_task_totals(out, &state->tasks[i]);
+	write_task_totals(out, &state->tasks[METRICS_MAX_TASKS]);
+
+	fprintf(out, "# HELP checker_task_failures_total Failed tasks by name and failing stage.\n");
+	fprintf(out, "# TYPE checker_task_failures_total counter\n");
+	for (i = 0; i < state->task_count; i++)
+		write_task_failures(out, &state->tasks[i]);
+	write_task_failures(out, &state->tasks[METRICS_MAX_TASKS]);
+
+	fprintf(out, "# HELP checker_stage_duration_seconds Duration of clone, fetch, lint and execution.\n");
+	fprintf(out, "# TYPE checker_stage_duration_seconds histogram\n");
+	for (i = 0; i < HIST_COUNT; i++)
+	{
+		h = &state->hist[i];
+		cumulative = 0;
+		for (b = 0; b < HIST_BUCKETS; b++)
+		{
+			cumulative += h->buckets[b];
+			fprintf(out, "checker_stage_duration_seconds_bucket{stage=\"%s\",le=\"%g\"} %ld\n",
+					hist_names[i], bucket_bounds[b], cumulative);
+		}
+		cumulative += h->buckets[HIST_BUCKETS];
+		fprintf(out, "checker_stage_duration_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %ld\n",
+				hist_names[i], cumulative);
+		fprintf(out, "checker_stage_duration_seconds_sum{stage=\"%s\"} %.6f\n",
+				hist_names[i], h->sum_us / 1e6);
+		fprintf(out, "checker_stage_duration_seconds_count{stage=\"%s\"} %ld\n",
+				hist_names[i], h->count);
+	}
+}
@@ -0,0 +1,32 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdio.h>
+
+typedef enum {
+	JOB_STARTED,
+	JOB_PASSED,
+	JOB_FAILED,
+	JOB_TIMED_OUT,
+	JOB_OUTCOME_COUNT
+} JobOutcome;
+
+typedef enum {
+	HIST_CLONE,
+	HIST_FETCH,
+	HIST_LINT,
+	HIST_EXECUTION,
+	HIST_COUNT
+} StageHistogram;
+
+int metrics_init(const char **task_names, int task_count);
+void metrics_job(JobOutcome outcome);
+void metrics_in_flight(int delta);
+void metrics_task_started(const char *task_name);
+void metrics_task_passed(const char *task_name);
+void metrics_task_failed(const char *task_name, int stage);
+double metrics_now(void);
+void metrics_observe(StageHistogram hist, double start);
+void metrics_write(FILE *out);
+
+#endif
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "reporter.h"
+
+static const ReportSink *sink = &plain_sink;
+static FILE *recording;
+
+/**
+ * report_init - Selects the output backend.
+ * @format: "tty", "plain", "json", or NULL to animate only on a terminal
+ *
+ * Return: 0 on success, 1 if @format is unknown
+ */
+int report_init(const char *format)
+{
+	if (!format)
+		sink = isatty(STDOUT_FILENO) ? &tty_sink : &plain_sink;
+	else if (strcmp(format, "tty") == 0)
+		sink = &tty_sink;
+	else if (strcmp(format, "plain") == 0)
+		sink = &plain_sink;
+	else if (strcmp(format, "json") == 0)
+		sink = &json_sink;
+	else
+		return 1;
+
+	return 0;
+}
+
+const char *report_format(void)
+{
+	return sink->name;
+}
+
+static void report_va(ReportLevel level, unsigned int delay_us, const char *format, va_list args)
+{
+	char buffer[4096];
+
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	sink->message(level, delay_us, buffer);
+	if (recording)
+		fprintf(recording, "%c %lu\n%s", level == REPORT_ERROR ? 'E' : 'I',
+				(unsigned long)strlen(buffer), buffer);
+}
+
+void report_info(const char *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	report_va(REPORT_INFO, 0, format, args);
+	va_end(args);
+}
+
+void report_error(const char *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	report_va(REPORT_ERROR, 0, format, args);
+	va_end(args);
+}
+
+/* Status line that the TTY backend types out character by character */
+void report_progress(unsigned int delay_us, const char *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	report_va(REPORT_INFO, delay_us, format, args);
+	va_end(args);
+}
+
+void report_perror(const char *prefix)
+{
+	report_error("%s: %s\n", prefix, strerror(errno));
+}
+
+void report_task(const char *task, const char *event, const char *detail)
+{
+	if (sink->task_event)
+		sink->task_event(task, event, detail);
+}
+
+/* Must be called before fork() or dup2() on the standard descriptors */
+void report_flush(void)
+{
+	sink->flush();
+}
+
+/**
+ * report_record - Also appends every message to @fp, NULL to stop.
+ * @fp: Stream that report_replay() can later read back
+ *
+ * Each message is stored as "<I|E> <length>\n" followed by its text.
+ */
+void report_record(FILE *fp)
+{
+	recording = fp;
+}
+
+/**
+ * report_replay - Sends messages saved by report_record() to the sink.
+ * @fp: Stream positioned at the first record
+ *
+ * Return: 0 on success, 1 if the stream is malformed
+ */
+int report_replay(FILE *fp)
+{
+	char header[64];
+	char level;
+	unsigned long length;
+	char *text;
+
+	while (fgets(header, sizeof(header), fp))
+	{
+		if (sscanf(header, "%c %lu", &level, &length) != 2 || length >= 65536)
+			return 1;
+		text = malloc(length + 1);
+		if (!text)
+			return 1;
+		if (fread(text, 1, length, fp) != length)
+		{
+			free(text);
+			return 1;
+		}
+		text[length] = '\0';
+		sink->message(level == 'E' ? REPORT_ERROR : REPORT_INFO, 0, text);
+		free(text);
+	}
+	return 0;
+}
@@ -0,0 +1,37 @@
+#ifndef REPORTER_H
+#define REPORTER_H
+
+#include <stdio.h>
+
+typedef enum {
+	REPORT_INFO,
+	REPORT_ERROR
+} ReportLevel;
+
+/*
+ * An output backend. @message receives fully formatted text; @delay_us is
+ * the per-character animation hint that only the TTY backend honours.
+ */
+typedef struct {
+	const char *name;
+	void (*message)(ReportLevel level, unsigned int delay_us, const char *text);
+	void (*task_event)(const char *task, const char *event, const char *detail);
+	void (*flush)(void);
+} ReportSink;
+
+extern const ReportSink tty_sink;
+extern const ReportSink plain_sink;
+extern const ReportSink json_sink;
+
+int report_init(const char *format);
+const char *report_format(void);
+void report_info(const char *format, ...);
+void report_error(const char *format, ...);
+void report_progress(unsigned int delay_us, const char *format, ...);
+void report_perror(const char *prefix);
+void report_task(const char *task, const char *event, const char *detail);
+void report_flush(void);
+void report_record(FILE *fp);
+int report_replay(FILE *fp);
+
+#endif
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <string.h>
+#include "reporter.h"
+
+/*
+ * One JSON object per line on stdout:
+ *   {"type":"log","stream":"stdout","text":"..."}
+ *   {"type":"task","task":"recursion","event":"passed","detail":null}
+ */
+
+static void put_json_string(const char *str)
+{
+	const unsigned char *p = (const unsigned char *)str;
+
+	if (!str)
+	{
+		fputs("null", stdout);
+		return;
+	}
+
+	putchar('"');
+	for (; *p; p++)
+	{
+		switch (*p)
+		{
+		case '"':
+			fputs("\\\"", stdout);
+			break;
+		case '\\':
+			fputs("\\\\", stdout);
+			break;
+		case '\n':
+			fputs("\\n", stdout);
+			break;
+		case '\t':
+			fputs("\\t", stdout);
+			break;
+		case '\r':
+			fputs("\\r", stdout);
+			break;
+		default:
+			if (*p < 0x20)
+				printf("\\u%04x", *p);
+			else
+				putchar(*p);
+		}
+	}
+	putchar('"');
+}
+
+static void json_message(ReportLevel level, unsigned int delay_us, const char *text)
+{
+	(void)delay_us;
+	if (*text == '\0')
+		return;
+
+	fputs("{\"type\":\"log\",\"stream\":", stdout);
+	fputs(level == REPORT_ERROR ? "\"stderr\"" : "\"stdout\"", stdout);
+	fputs(",\"text\":", stdout);
+	put_json_string(text);
+	fputs("}\n", stdout);
+}
+
+static void json_task_event(const char *task, const char *event, const char *detail)
+{
+	fputs("{\"type\":\"task\",\"task\":", stdout);
+	put_json_string(task);
+	fputs(",\"event\":", stdout);
+	put_json_string(event);
+	fputs(",\"detail\":", stdout);
+	put_json_string(detail);
+	fputs("}\n", stdout);
+}
+
+static void json_flush(void)
+{
+	fflush(stdout);
+}
+
+const ReportSink json_sink = {
+	"json",
+	json_message,
+	json_task_event,
+	json_flush
+};
@@ -0,0 +1,91 @@
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "reporter.h"
+
+#define LINE_MAX_LEN 4096
+
+typedef struct {
+	int fd;
+	size_t used;
+	char line[LINE_MAX_LEN];
+} LineBuffer;
+
+static LineBuffer out_buffer = { STDOUT_FILENO, 0, "" };
+static LineBuffer err_buffer = { STDERR_FILENO, 0, "" };
+
+static void drain(LineBuffer *buf)
+{
+	const char *p = buf->line;
+	ssize_t n;
+
+	while (buf->used > 0)
+	{
+		n = write(buf->fd, p, buf->used);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		p += n;
+		buf->used -= n;
+	}
+	buf->used = 0;
+}
+
+/* Collects text and issues one write() per complete line */
+static void append(LineBuffer *buf, const char *text)
+{
+	const char *newline;
+	size_t len;
+
+	while (*text)
+	{
+		newline = strchr(text, '\n');
+		len = newline ? (size_t)(newline - text) + 1 : strlen(text);
+		if (len > LINE_MAX_LEN - buf->used)
+			len = LINE_MAX_LEN - buf->used;
+
+		memcpy(buf->line + buf->used, text, len);
+		buf->used += len;
+		text += len;
+
+		if (buf->line[buf->used - 1] == '\n' || buf->used == LINE_MAX_LEN)
+			drain(buf);
+	}
+}
+
+static void plain_message(ReportLevel level, unsigned int delay_us, const char *text)
+{
+	(void)delay_us;
+	if (level == REPORT_ERROR)
+	{
+		drain(&out_buffer);
+		append(&err_buffer, text);
+	}
+	else
+	{
+		append(&out_buffer, text);
+	}
+}
+
+static void plain_task_event(const char *task, const char *event, const char *detail)
+{
+	(void)task;
+	(void)event;
+	(void)detail;
+}
+
+static void plain_flush(void)
+{
+	drain(&out_buffer);
+	drain(&err_buffer);
+}
+
+const ReportSink plain_sink = {
+	"plain",
+	plain_message,
+	plain_task_event,
+	plain_flush
+};
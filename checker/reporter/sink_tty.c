@@ -0,0 +1,38 @@
+#include <stdio.h>
+#include "reporter.h"
+#include "../typewriter/typewriter.h"
+
+static void tty_message(ReportLevel level, unsigned int delay_us, const char *text)
+{
+	if (level == REPORT_ERROR)
+	{
+		fflush(stdout);
+		fputs(text, stderr);
+		return;
+	}
+
+	if (delay_us > 0)
+		typewrite(delay_us, "%s", text);
+	else
+		fputs(text, stdout);
+}
+
+static void tty_task_event(const char *task, const char *event, const char *detail)
+{
+	(void)task;
+	(void)event;
+	(void)detail;
+}
+
+static void tty_flush(void)
+{
+	fflush(stdout);
+	fflush(stderr);
+}
+
+const ReportSink tty_sink = {
+	"tty",
+	tty_message,
+	tty_task_event,
+	tty_flush
+};
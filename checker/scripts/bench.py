@@ -0,0 +1,298 @@
+#!/usr/bin/env python3
+"""End-to-end checker benchmark on synthetic local repositories.
+
+Builds N student repositories as bare repos reachable through
+file:///<workdir>/github.com/<user>/recursion-readme.git (which passes
+is_valid_git_url and extract_username), generates task catalogs of several
+sizes, then drives the checker end to end and reports throughput and
+p50/p95/p99 latency per traced stage.
+
+    python3 scripts/bench.py --checker ./checker --repos 20 --catalog-sizes 10,100
+"""
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+import time
+
+RECURSION = '''#!/usr/bin/env python3
+
+def recursion(n):
+    """Print n down to 0."""
+    if n < 0:
+        return
+    print(n)
+    recursion(n - 1)
+
+
+recurse = recursion
+'''
+
+RECURSION_MAIN = '''#!/usr/bin/env python3
+
+from recursion import recurse
+
+print("Recursion from 5:")
+recurse(5)
+print()
+
+print("Recursion from 0:")
+recurse(0)
+print()
+
+print("Recursion from -1 (should print nothing):")
+recurse(-1)
+'''
+
+FACTORIAL = '''#!/usr/bin/env python3
+
+def factorial(n):
+    """Return n!."""
+    if n <= 1:
+        return 1
+    return n * factorial(n - 1)
+'''
+
+FACTORIAL_MAIN = '''#!/usr/bin/env python3
+
+from factorial import factorial
+
+print("factorial(0) =", factorial(0))
+print("factorial(1) =", factorial(1))
+print("factorial(3) =", factorial(3))
+print("factorial(5) =", factorial(5))
+'''
+
+REAL_TASKS = [
+    {
+        "name": "recursion",
+        "path": "algorithms/tasks/recursion",
+        "main": "main.py",
+        "target": "recursion.py",
+        "expected_output": "Recursion from 5:\n5\n4\n3\n2\n1\n0\n\nRecursion from 0:\n0\n\n"
+                           "Recursion from -1 (should print nothing):\n",
+        "rules": {
+            "header": ["#!/usr/bin/env python3", ""],
+            "signature": "def recursion(*",
+            "docstring": "definition",
+            "banned": ["for", "while"],
+        },
+    },
+    {
+        "name": "factorial",
+        "path": "algorithms/tasks/factorial",
+        "main": "main.py",
+        "target": "factorial.py",
+        "expected_output": "factorial(0) = 1\nfactorial(1) = 1\nfactorial(3) = 6\nfactorial(5) = 120\n",
+        "rules": {
+            "header": ["#!/usr/bin/env python3", ""],
+            "signature": "def factorial(n)*",
+            "docstring": "definition",
+            "banned": ["for", "while"],
+        },
+    },
+]
+
+SOURCES = {
+    "recursion": (RECURSION, RECURSION_MAIN),
+    "factorial": (FACTORIAL, FACTORIAL_MAIN),
+}
+
+
+def run(cmd, cwd=None):
+    subprocess.run(cmd, cwd=cwd, check=True, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+
+
+def write(path, content, mode=0o644):
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, "w") as f:
+        f.write(content)
+    os.chmod(path, mode)
+
+
+def make_repo(workdir, user, filler_dirs):
+    """Create one student's repository and publish it as a bare repo."""
+    src = os.path.join(workdir, "src", user)
+    bare = os.path.join(workdir, "github.com", user, "recursion-readme.git")
+    shutil.rmtree(src, ignore_errors=True)
+    shutil.rmtree(bare, ignore_errors=True)
+
+    for task in REAL_TASKS:
+        target, main = SOURCES[task["name"]]
+        base = os.path.join(src, task["path"])
+        write(os.path.join(base, task["target"]), target, 0o755)
+        write(os.path.join(base, task["main"]), main, 0o755)
+        write(os.path.join(base, "README.md"), "# %s\n" % task["name"])
+    for i in range(filler_dirs):
+        write(os.path.join(src, "projects", "p%d" % i, "notes.md"), ("%s %d\n" % (user, i)) * 64)
+
+    run(["git", "init", "-q", "-b", "main"], cwd=src)
+    run(["git", "add", "-A"], cwd=src)
+    run(["git", "-c", "user.name=bench", "-c", "user.email=bench@localhost",
+         "commit", "-q", "-m", "submission"], cwd=src)
+    run(["git", "clone", "-q", "--bare", src, bare])
+    return "file://" + bare
+
+
+def make_catalog(workdir, size):
+    """The two real tasks padded with synthetic ones up to size entries."""
+    tasks = list(REAL_TASKS)
+    for i in range(max(0, size - len(tasks))):
+        tasks.append({
+            "name": "synthetic_%d" % i,
+            "path": "projects/p%d" % i,
+            "main": "main.py",
+            "target": "task_%d.py" % i,
+            "expected_output": "ok\n",
+        })
+    path = os.path.join(workdir, "catalogs", "tasks_%d.json" % size)
+    write(path, json.dumps(tasks, indent=1))
+    return path
+
+
+def percentile(values, pct):
+    if not values:
+        return 0.0
+    ordered = sorted(values)
+    rank = max(0, min(len(ordered) - 1, int(round(pct / 100.0 * len(ordered) + 0.5)) - 1))
+    return ordered[rank]
+
+
+def stage_durations(trace_path):
+    """Pair B/E events per worker and return {stage: [seconds, ...]}."""
+    with open(trace_path) as f:
+        text = f.read().rstrip().rstrip(",")
+    if not text.endswith("]"):
+        text += "]"
+    stacks, stages = {}, {}
+    for event in json.loads(text):
+        if event.get("ph") == "B":
+            stacks.setdefault(event["tid"], []).append(event)
+        elif event.get("ph") == "E":
+            stack = stacks.get(event["tid"])
+            if stack:
+                begin = stack.pop()
+                stages.setdefault(begin["name"], []).append((event["ts"] - begin["ts"]) / 1e6)
+    return stages
+
+
+def lint_worker_state(stages):
+    """"used" if the pycodestyle worker linted every batch, "fallback" if the
+    pycodestyle command had to, "idle" if nothing was linted (all cached)."""
+    if stages.get("pycodestyle"):
+        return "fallback"
+    return "used" if stages.get("lint_worker") else "idle"
+
+
+def run_checker(args, cwd, catalog, extra, trace):
+    cmd = [args.checker, "--format", "plain", "--catalog", catalog, "--trace", trace] + extra
+    start = time.monotonic()
+    proc = subprocess.run(cmd, cwd=cwd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+    return time.monotonic() - start, proc.returncode
+
+
+def scenario(args, workdir, urls, catalog, label, batch):
+    """Run every repo once (cold clones) and once more (updates)."""
+    results = []
+    run_dir = os.path.join(workdir, "run_%s" % label)
+    shutil.rmtree(run_dir, ignore_errors=True)
+    os.makedirs(os.path.join(run_dir, "logs"))
+
+    for phase in ("cold", "warm"):
+        trace = os.path.join(run_dir, "trace_%s.json" % phase)
+        if batch:
+            manifest = os.path.join(run_dir, "repos.txt")
+            write(manifest, "".join("%s recursion,factorial\n" % url for url in urls))
+            wall, code = run_checker(args, run_dir, catalog,
+                                     ["--manifest", manifest, "--jobs", str(args.jobs),
+                                      "--output", os.path.join(run_dir, "results.tsv")], trace)
+            failures = 1 if code else 0
+        else:
+            wall, failures = 0.0, 0
+            # One trace per invocation, merged afterwards
+            for i, url in enumerate(urls):
+                part = "%s.%d" % (trace, i)
+                elapsed, code = run_checker(args, run_dir, catalog,
+                                            ["--task-name", "recursion,factorial", "--repo", url,
+                                             "--jobs", str(args.jobs)], part)
+                wall += elapsed
+                failures += 1 if code else 0
+            with open(trace, "w") as out:
+                out.write("[\n")
+                for i in range(len(urls)):
+                    part = "%s.%d" % (trace, i)
+                    with open(part) as f:
+                        body = f.read().strip()
+                    out.write(body[1:].rstrip().rstrip("]").rstrip().rstrip(",") + ",\n")
+                    os.remove(part)
+                out.write('{"name":"end","ph":"M","pid":0}\n]\n')
+
+        stages = stage_durations(trace)
+        results.append({
+            "scenario": label,
+            "phase": phase,
+            "repos": len(urls),
+            "wall_seconds": round(wall, 4),
+            "repos_per_second": round(len(urls) / wall, 3) if wall else 0.0,
+            "failed_runs": failures,
+            "lint_worker": lint_worker_state(stages),
+            "stages": {
+                name: {
+                    "count": len(values),
+                    "p50": round(percentile(values, 50), 6),
+                    "p95": round(percentile(values, 95), 6),
+                    "p99": round(percentile(values, 99), 6),
+                }
+                for name, values in sorted(stages.items())
+            },
+        })
+    return results
+
+
+def print_report(results):
+    for r in results:
+        print("\n== %s / %s: %d repos in %.2fs (%.2f repos/s, %d failed runs, lint worker %s)" % (
+            r["scenario"], r["phase"], r["repos"], r["wall_seconds"],
+            r["repos_per_second"], r["failed_runs"], r["lint_worker"]))
+        print("   %-16s %7s %10s %10s %10s" % ("stage", "count", "p50 ms", "p95 ms", "p99 ms"))
+        for name, s in r["stages"].items():
+            print("   %-16s %7d %10.2f %10.2f %10.2f" % (
+                name, s["count"], s["p50"] * 1e3, s["p95"] * 1e3, s["p99"] * 1e3))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--checker", default="./checker")
+    parser.add_argument("--workdir", default="bench_work")
+    parser.add_argument("--repos", type=int, default=20)
+    parser.add_argument("--filler-dirs", type=int, default=20,
+                        help="unrelated directories per repository")
+    parser.add_argument("--catalog-sizes", default="10,100")
+    parser.add_argument("--jobs", type=int, default=4)
+    parser.add_argument("--output", default="bench_results.json")
+    args = parser.parse_args()
+
+    args.checker = os.path.abspath(args.checker)
+    workdir = os.path.abspath(args.workdir)
+    os.makedirs(workdir, exist_ok=True)
+
+    print("Generating %d repositories in %s ..." % (args.repos, workdir))
+    urls = [make_repo(workdir, "student%03d" % i, args.filler_dirs) for i in range(args.repos)]
+
+    results = []
+    for size in [int(s) for s in args.catalog_sizes.split(",") if s]:
+        catalog = make_catalog(workdir, size)
+        results += scenario(args, workdir, urls, catalog, "single_c%d" % size, batch=False)
+        results += scenario(args, workdir, urls, catalog, "batch_c%d" % size, batch=True)
+
+    print_report(results)
+    with open(args.output, "w") as f:
+        json.dump(results, f, indent=2)
+    print("\nResults written to %s" % args.output)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
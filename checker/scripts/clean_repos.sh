@@ -1,31 +1,14 @@
 #!/bin/bash
 
+# Evicts cloned_repo_* workspaces idle for more than 24 hours, then the least
+# recently used ones until the rest fits the disk budget. The checker keeps
+# the workspace index (logs/workspaces.idx) itself; extra arguments such as
+# --disk-budget <MiB> are passed through.
+
 # Get the directory of this script
 SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
 ROOT_DIR="$SCRIPT_DIR/.."
 
-LOG_FILE="$ROOT_DIR/logs/repo_timestamps.log"
-TEMP_LOG="$ROOT_DIR/logs/repo_timestamps.tmp"
-CUTOFF=60  # 24 hours
-NOW=$(date +%s)
-
-mkdir -p "$ROOT_DIR/logs"
-> "$TEMP_LOG"
-
-while IFS=: read -r USERNAME REPO_DIR TIMESTAMP; do
-	# Skip malformed lines
-	if [[ -z "$USERNAME" || -z "$REPO_DIR" || -z "$TIMESTAMP" ]]; then
-		continue
-	fi
-
-	AGE=$((NOW - TIMESTAMP))
-
-	if [ "$AGE" -ge "$CUTOFF" ]; then
-		echo "Deleting expired repo: $REPO_DIR (owned by $USERNAME, age: ${AGE}s)"
-		rm -rf "$ROOT_DIR/$REPO_DIR"
-	else
-		echo "$USERNAME:$REPO_DIR:$TIMESTAMP" >> "$TEMP_LOG"
-	fi
-done < "$LOG_FILE"
-
-mv "$TEMP_LOG" "$LOG_FILE"
+cd "$ROOT_DIR" || exit 1
+mkdir -p logs
+exec ./checker --prune-workspaces "$@"
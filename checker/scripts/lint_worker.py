@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""Long-lived pycodestyle worker, started once by the checker.
+
+The checker (validators/linters/lint_worker.c) talks to it over a socket on
+stdin/stdout with length-prefixed frames:
+
+    request:  "<id> lint <length>\\n" then <length> bytes of NUL-separated paths
+    response: "<id> <status> <length>\\n" then <length> bytes
+
+status is "ok" with one "<path index>\\t<row>\\t<col>\\t<code> <text>\\n" line
+per diagnostic, "error" with a message, or "unavailable" when pycodestyle
+cannot be imported, in which case the checker runs pycodestyle itself.
+A "version" request (no payload) is answered with the pycodestyle version
+and the options in effect; the lint cache keys its entries on that text.
+
+Options come from pycodestyle's defaults and the user configuration, as on
+the command line; per-project files (setup.cfg, tox.ini) in the student's
+repository are ignored.
+"""
+import sys
+
+try:
+    import pycodestyle
+except ImportError as exc:
+    pycodestyle = None
+    MISSING = str(exc)
+
+
+def make_style():
+    """StyleGuide whose report keeps diagnostics instead of printing them."""
+
+    class Collector(pycodestyle.BaseReport):
+        def __init__(self, options):
+            super().__init__(options)
+            self.diagnostics = []
+
+        def error(self, line_number, offset, text, check):
+            code = super().error(line_number, offset, text, check)
+            if code:
+                self.diagnostics.append((line_number, offset + 1, text))
+            return code
+
+    # The user configuration is always read; project files need paths
+    style = pycodestyle.StyleGuide(reporter=Collector)
+    return style, style.init_report(Collector)
+
+
+# Options that change what pycodestyle reports
+OPTIONS = ('select', 'ignore', 'max_line_length', 'max_doc_length',
+           'indent_size', 'hang_closing')
+
+
+def describe(style):
+    lines = ['pycodestyle %s\n' % pycodestyle.__version__]
+    for name in OPTIONS:
+        lines.append('%s=%r\n' % (name, getattr(style.options, name, None)))
+    return ''.join(lines)
+
+
+def lint(style, report, paths):
+    lines = []
+    for index, path in enumerate(paths):
+        report.diagnostics = []
+        style.input_file(path)
+        for row, col, text in sorted(report.diagnostics):
+            lines.append('%d\t%d\t%d\t%s\n' % (index, row, col, text))
+    return ''.join(lines)
+
+
+def read_frame(stream):
+    header = stream.readline()
+    if not header:
+        return None
+    request_id, verb, length = header.split()
+    payload = stream.read(int(length))
+    if len(payload) != int(length):
+        return None
+    return request_id, verb, payload
+
+
+def reply(stream, request_id, status, text):
+    body = text.encode('utf-8', 'replace')
+    stream.write(b'%s %s %d\n' % (request_id, status, len(body)) + body)
+    stream.flush()
+
+
+def main():
+    stdin, stdout = sys.stdin.buffer, sys.stdout.buffer
+    style = report = None
+    if pycodestyle:
+        style, report = make_style()
+    while True:
+        frame = read_frame(stdin)
+        if frame is None:
+            return
+        request_id, verb, payload = frame
+        if not pycodestyle:
+            reply(stdout, request_id, b'unavailable', MISSING)
+        elif verb == b'version':
+            reply(stdout, request_id, b'ok', describe(style))
+        elif verb != b'lint':
+            reply(stdout, request_id, b'error', 'unknown request')
+        else:
+            paths = [p.decode('utf-8', 'surrogateescape')
+                     for p in payload.split(b'\0') if p]
+            try:
+                reply(stdout, request_id, b'ok', lint(style, report, paths))
+            except Exception as exc:  # one bad file must not end the worker
+                reply(stdout, request_id, b'error', '%s: %s' % (
+                    type(exc).__name__, exc))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""Checks that --gc-cache shrinks the shared object store after eviction.
+
+Clones a few synthetic student repositories (see bench.py) so their blobs
+land in cache/objects.git, ages every workspace past the idle limit, runs
+--prune-workspaces to evict them and then --gc-cache, and fails unless the
+store ends up with fewer objects than it had.
+
+    python3 scripts/test_store_gc.py --checker ./checker
+"""
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from bench import make_catalog, make_repo  # noqa: E402
+
+
+def git(store, *args):
+    return subprocess.run(["git", "-C", store] + list(args), check=True,
+                          stdout=subprocess.PIPE, text=True).stdout
+
+
+def object_count(store):
+    counts = dict(line.split(": ") for line in git(store, "count-objects", "-v").splitlines())
+    return int(counts["count"]) + int(counts["in-pack"])
+
+
+def checker(args, run_dir, *extra):
+    return subprocess.run([args.checker, "--format", "plain"] + list(extra), cwd=run_dir,
+                          stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--checker", default="./checker")
+    parser.add_argument("--repos", type=int, default=3)
+    args = parser.parse_args()
+    args.checker = os.path.abspath(args.checker)
+
+    workdir = tempfile.mkdtemp(prefix="store_gc.")
+    try:
+        run_dir = os.path.join(workdir, "run")
+        os.makedirs(os.path.join(run_dir, "logs"))
+        catalog = make_catalog(workdir, 2)
+        for i in range(args.repos):
+            url = make_repo(workdir, "student%03d" % i, 2)
+            checker(args, run_dir, "--catalog", catalog, "--task-name", "recursion,factorial",
+                    "--repo", url)
+
+        store = os.path.join(run_dir, "cache", "objects.git")
+        before = object_count(store)
+        refs = git(store, "for-each-ref", "refs/users").splitlines()
+        if before == 0 or len(refs) != args.repos:
+            print("FAIL: store holds %d objects and %d user refs after %d clones"
+                  % (before, len(refs), args.repos))
+            return 1
+
+        # Idle since the epoch, so --prune-workspaces evicts every workspace
+        index = os.path.join(run_dir, "logs", "workspaces.idx")
+        with open(index) as f:
+            entries = [line.split(":") for line in f.read().splitlines()]
+        with open(index, "w") as f:
+            f.write("".join("%s:%s:0:%s\n" % (e[0], e[1], e[3]) for e in entries))
+        checker(args, run_dir, "--prune-workspaces")
+        refs = git(store, "for-each-ref", "refs/users").splitlines()
+        if refs:
+            print("FAIL: eviction left %d user refs in the store" % len(refs))
+            return 1
+
+        proc = checker(args, run_dir, "--gc-cache")
+        after = object_count(store)
+        print("store objects: %d before eviction, %d after --gc-cache" % (before, after))
+        if proc.returncode != 0 or after >= before:
+            print("FAIL: --gc-cache did not shrink the store")
+            return 1
+        print("OK")
+        return 0
+    finally:
+        shutil.rmtree(workdir, ignore_errors=True)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,9 +1,81 @@
-from flask import Flask, render_template, request, jsonify
+from flask import Flask, Response, render_template, request, jsonify
 import subprocess
+import socket
 import os
 
 app = Flask(__name__)
 
+CHECKER_DIR = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+CHECKER_SOCKET = os.environ.get("CHECKER_SOCKET", os.path.join(CHECKER_DIR, "checker.sock"))
+CHECKER_TIMEOUT = 30
+
+# Requests seen by this server process, by how they ended
+request_outcomes = {"ok": 0, "semantic_error": 0, "timeout": 0, "unavailable": 0}
+
+
+class CheckerResult:
+    def __init__(self, returncode, stdout, stderr, tasks=None):
+        self.returncode = returncode
+        self.stdout = stdout
+        self.stderr = stderr
+        self.tasks = tasks or []
+
+
+def read_block(reader, label):
+    header = reader.readline().decode().split()
+    if len(header) != 2 or header[0] != label:
+        raise ConnectionError("Malformed checker daemon response")
+    return reader.read(int(header[1])).decode(errors="replace")
+
+
+def run_checker_daemon(task_name, repo_url):
+    """Send one job to a running `checker --daemon` over its Unix socket."""
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as sock:
+        sock.settimeout(CHECKER_TIMEOUT)
+        sock.connect(CHECKER_SOCKET)
+        sock.sendall(f"CHECK {repo_url} {task_name}\n".encode())
+        reader = sock.makefile("rb")
+
+        status = reader.readline().decode().split()
+        if not status:
+            # The daemon killed the job at its own timeout
+            raise socket.timeout("Checker daemon closed the connection")
+        if len(status) != 2 or status[0] != "EXIT":
+            raise ConnectionError("Checker daemon rejected the job")
+        returncode = int(status[1])
+
+        tasks = []
+        line = reader.readline().decode()
+        while line.startswith("TASK "):
+            _, name, outcome = line.split()
+            tasks.append({"name": name, "status": outcome})
+            line = reader.readline().decode()
+        if not line.startswith("STDOUT "):
+            raise ConnectionError("Malformed checker daemon response")
+        stdout = reader.read(int(line.split()[1])).decode(errors="replace")
+        stderr = read_block(reader, "STDERR")
+
+    return CheckerResult(returncode, stdout, stderr, tasks)
+
+
+def run_checker(task_name, repo_url):
+    """Prefer the warm daemon, fall back to spawning the checker binary."""
+    if os.path.exists(CHECKER_SOCKET):
+        try:
+            return run_checker_daemon(task_name, repo_url)
+        except (FileNotFoundError, ConnectionRefusedError):
+            pass
+
+    result = subprocess.run(
+            ["./checker", "--task-name", task_name, "--repo", repo_url],
+            stdout=subprocess.PIPE,
+            stderr=subprocess.PIPE,
+            text=True,
+            cwd=CHECKER_DIR,
+            timeout=CHECKER_TIMEOUT
+            )
+    return CheckerResult(result.returncode, result.stdout, result.stderr)
+
 
 @app.route("/")
 def index():
@@ -25,19 +97,18 @@ def validate():
         return "Task name and repo URL are required", 400
 
     try:
-        result = subprocess.run(
-                ["./checker", "--task-name", task_name, "--repo", repo_url],
-                stdout=subprocess.PIPE,
-                stderr=subprocess.PIPE,
-                text=True,
-                cwd="../",
-                timeout=30
-                )
-    except subprocess.TimeoutExpired:
+        result = run_checker(task_name, repo_url)
+    except (subprocess.TimeoutExpired, socket.timeout):
+        request_outcomes["timeout"] += 1
         return "Checker timed out", 500
-    except FileNotFoundError:
+    except (FileNotFoundError, ConnectionError):
+        request_outcomes["unavailable"] += 1
         return "Checker executable not found", 500
 
+    semantic_error = "Validation failed" in result.stderr or "Missing" in result.stderr or "not found" in result.stderr
+    failed = semantic_error or result.returncode != 0
+    request_outcomes["semantic_error" if failed else "ok"] += 1
+
     # If it's an HTML form, render response.html
     if not request.is_json:
         return render_template(
@@ -50,11 +121,11 @@ def validate():
                 )
 
     # Otherwise return JSON
-    semantic_error = "Validation failed" in result.stderr or "Missing" in result.stderr or "not found" in result.stderr
     return {
             "task_name": task_name,
             "repo_url": repo_url,
-            "exit_code": 1 if semantic_error or result.returncode != 0 else 0,
+            "exit_code": 1 if failed else 0,
+            "tasks": result.tasks,
             "stdout": result.stdout,
             "stderr": result.stderr
             }
@@ -65,5 +136,35 @@ def health_check():
     return jsonify({"status": "ok", "message": "Checker is running"}), 200
 
 
+def checker_metrics():
+    """Live counters from the daemon.
+
+    Only the daemon keeps counters across jobs; one-shot runs spawned by the
+    fallback in run_checker() report nothing here.
+    """
+    if not os.path.exists(CHECKER_SOCKET):
+        return ""
+    try:
+        with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as sock:
+            sock.settimeout(5)
+            sock.connect(CHECKER_SOCKET)
+            sock.sendall(b"METRICS\n")
+            return sock.makefile("rb").read().decode()
+    except OSError:
+        return ""
+
+
+@app.route('/metrics', methods=['GET'])
+def metrics():
+    lines = [
+            "# HELP checker_server_requests_total Validate requests handled by this server.",
+            "# TYPE checker_server_requests_total counter",
+            ]
+    for outcome, count in request_outcomes.items():
+        lines.append(f'checker_server_requests_total{{outcome="{outcome}"}} {count}')
+    body = "\n".join(lines) + "\n" + checker_metrics()
+    return Response(body, mimetype="text/plain; version=0.0.4")
+
+
 if __name__ == "__main__":
     app.run(debug=True)
@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "trace.h"
+
+int trace_enabled = 0;
+static int trace_fd = -1;
+static pid_t trace_owner;
+
+static long now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long)ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+/* Copies @src into @dst as the body of a JSON string, truncating if needed */
+static void json_escape(char *dst, size_t size, const char *src)
+{
+	size_t used = 0;
+
+	for (; *src && used + 7 < size; src++)
+	{
+		if (*src == '"' || *src == '\\')
+		{
+			dst[used++] = '\\';
+			dst[used++] = *src;
+		}
+		else if ((unsigned char)*src < 0x20)
+		{
+			used += sprintf(dst + used, "\\u%04x", (unsigned char)*src);
+		}
+		else
+		{
+			dst[used++] = *src;
+		}
+	}
+	dst[used] = '\0';
+}
+
+/**
+ * trace_open - Starts writing trace events to @path.
+ * @path: Output file, loadable in chrome://tracing or Perfetto
+ *
+ * The descriptor is opened O_APPEND and each event is a single write(), so
+ * forked workers inherit it and their events interleave safely.
+ *
+ * Return: 0 on success, 1 on failure
+ */
+int trace_open(const char *path)
+{
+	trace_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+	if (trace_fd < 0)
+		return 1;
+
+	trace_owner = getpid();
+	if (write(trace_fd, "[\n", 2) != 2)
+	{
+		close(trace_fd);
+		trace_fd = -1;
+		return 1;
+	}
+	trace_enabled = 1;
+	return 0;
+}
+
+void trace_event(const char *name, char phase, const char *detail)
+{
+	char line[1024];
+	char escaped[512];
+	int len;
+
+	if (trace_fd < 0)
+		return;
+
+	if (detail)
+	{
+		json_escape(escaped, sizeof(escaped), detail);
+		len = snprintf(line, sizeof(line),
+				"{\"name\":\"%s\",\"cat\":\"checker\",\"ph\":\"%c\",\"ts\":%ld,"
+				"\"pid\":%ld,\"tid\":%ld,\"args\":{\"detail\":\"%s\"}},\n",
+				name, phase, now_us(), (long)trace_owner, (long)getpid(), escaped);
+	}
+	else
+	{
+		len = snprintf(line, sizeof(line),
+				"{\"name\":\"%s\",\"cat\":\"checker\",\"ph\":\"%c\",\"ts\":%ld,"
+				"\"pid\":%ld,\"tid\":%ld},\n",
+				name, phase, now_us(), (long)trace_owner, (long)getpid());
+	}
+
+	if (len > 0 && (size_t)len < sizeof(line))
+	{
+		if (write(trace_fd, line, len) != len)
+			trace_enabled = 0;
+	}
+}
+
+/* Terminates the event array; only the process that opened the trace does this */
+void trace_close(void)
+{
+	char line[256];
+	int len;
+
+	if (trace_fd < 0)
+		return;
+
+	if (getpid() == trace_owner)
+	{
+		len = snprintf(line, sizeof(line),
+				"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%ld,"
+				"\"args\":{\"name\":\"checker\"}}\n]\n", (long)trace_owner);
+		if (write(trace_fd, line, len) != len)
+			trace_enabled = 0;
+	}
+	close(trace_fd);
+	trace_fd = -1;
+	trace_enabled = 0;
+}
@@ -0,0 +1,20 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/*
+ * Stage tracing in Chrome trace-event format. Every TRACE_BEGIN must be
+ * matched by a TRACE_END with the same name on all paths out of the scope.
+ * When tracing is off each macro is a single branch on trace_enabled.
+ */
+extern int trace_enabled;
+
+#define TRACE_BEGIN(name, detail) \
+	do { if (trace_enabled) trace_event((name), 'B', (detail)); } while (0)
+#define TRACE_END(name) \
+	do { if (trace_enabled) trace_event((name), 'E', NULL); } while (0)
+
+int trace_open(const char *path);
+void trace_close(void);
+void trace_event(const char *name, char phase, const char *detail);
+
+#endif
@@ -0,0 +1,209 @@
+#include <stdlib.h>
+#include <string.h>
+#include "utils.h"
+
+/*
+ * Bump allocator for per-run data. Allocations are never freed one by
+ * one; arena_destroy() releases every block at once. Strings added with
+ * arena_intern() are stored once per arena, so the same task, file or
+ * directory name is shared by every task that mentions it.
+ */
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+typedef union {
+	long l;
+	double d;
+	void *p;
+} ArenaAlign;
+
+#define ARENA_ALIGN sizeof(ArenaAlign)
+#define ALIGN_UP(n) (((n) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+typedef struct ArenaBlock {
+	struct ArenaBlock *next;
+	size_t size;
+	size_t used;
+	ArenaAlign data[1];
+} ArenaBlock;
+
+struct Arena {
+	ArenaBlock *blocks; /* current block first */
+	void *last;         /* most recent allocation, which arena_grow() can extend */
+	HashMap *strings;   /* interned strings, keys stored in this arena */
+};
+
+static ArenaBlock *block_new(size_t size)
+{
+	ArenaBlock *block;
+
+	block = malloc(offsetof(ArenaBlock, data) + size);
+	if (!block)
+		return NULL;
+	block->next = NULL;
+	block->size = size;
+	block->used = 0;
+	return block;
+}
+
+/**
+ * arena_create - Creates an empty arena.
+ *
+ * Return: New arena, NULL on allocation failure
+ */
+Arena *arena_create(void)
+{
+	Arena *arena;
+
+	arena = calloc(1, sizeof(*arena));
+	return arena;
+}
+
+/**
+ * arena_alloc - Allocates zeroed memory that lives as long as the arena.
+ * @arena: Arena to allocate from
+ * @size: Number of bytes
+ *
+ * Return: Memory aligned for any basic type, NULL on allocation failure
+ */
+void *arena_alloc(Arena *arena, size_t size)
+{
+	ArenaBlock *block = arena->blocks;
+	char *ptr;
+
+	size = ALIGN_UP(size ? size : 1);
+	if (!block || block->size - block->used < size)
+	{
+		if (size > ARENA_BLOCK_SIZE / 4)
+		{
+			/* Large requests get a block of their own behind the current one */
+			block = block_new(size);
+			if (!block)
+				return NULL;
+			block->used = size;
+			if (arena->blocks)
+			{
+				block->next = arena->blocks->next;
+				arena->blocks->next = block;
+			}
+			else
+			{
+				arena->blocks = block;
+			}
+			memset(block->data, 0, size);
+			arena->last = block->data;
+			return block->data;
+		}
+		block = block_new(ARENA_BLOCK_SIZE);
+		if (!block)
+			return NULL;
+		block->next = arena->blocks;
+		arena->blocks = block;
+	}
+
+	ptr = (char *)block->data + block->used;
+	block->used += size;
+	memset(ptr, 0, size);
+	arena->last = ptr;
+	return ptr;
+}
+
+/**
+ * arena_grow - Resizes the most recent allocation, or copies an older one.
+ * @arena: Arena @old came from
+ * @old: Previous allocation, may be NULL
+ * @old_size: Size @old was allocated with
+ * @new_size: Size wanted, at least @old_size
+ *
+ * Growing vectors one after another stays in place, so doubling a vector
+ * costs no copy until something else is allocated after it.
+ *
+ * Return: Memory holding the old contents followed by zeroes, NULL on
+ * allocation failure (@old is left untouched)
+ */
+void *arena_grow(Arena *arena, void *old, size_t old_size, size_t new_size)
+{
+	ArenaBlock *block = arena->blocks;
+	size_t offset;
+	void *ptr;
+
+	if (old && old == arena->last && block &&
+			(char *)old >= (char *)block->data && (char *)old < (char *)block->data + block->size)
+	{
+		offset = (char *)old - (char *)block->data;
+		if (block->size - offset >= ALIGN_UP(new_size))
+		{
+			memset((char *)old + old_size, 0, new_size - old_size);
+			block->used = offset + ALIGN_UP(new_size);
+			return old;
+		}
+	}
+
+	ptr = arena_alloc(arena, new_size);
+	if (ptr && old)
+		memcpy(ptr, old, old_size);
+	return ptr;
+}
+
+/**
+ * arena_strdup - Copies a string into the arena.
+ * @arena: Arena to allocate from
+ * @str: String to copy
+ *
+ * Unlike arena_intern(), every call returns a private, writable copy.
+ *
+ * Return: The copy, NULL on allocation failure
+ */
+char *arena_strdup(Arena *arena, const char *str)
+{
+	size_t len = strlen(str) + 1;
+	char *copy;
+
+	copy = arena_alloc(arena, len);
+	if (copy)
+		memcpy(copy, str, len);
+	return copy;
+}
+
+/**
+ * arena_intern - Returns the arena's copy of a string.
+ * @arena: Arena holding the string table
+ * @str: String to look up, NULL is passed through
+ *
+ * Return: Shared, immutable copy of @str, NULL on allocation failure
+ */
+const char *arena_intern(Arena *arena, const char *str)
+{
+	const char *copy;
+
+	if (!str)
+		return NULL;
+	if (!arena->strings)
+	{
+		arena->strings = map_create(0, arena);
+		if (!arena->strings)
+			return NULL;
+	}
+	if (!map_put(arena->strings, str, &copy))
+		return NULL;
+	return copy;
+}
+
+/**
+ * arena_destroy - Releases an arena and everything allocated from it.
+ * @arena: Arena to release, may be NULL
+ */
+void arena_destroy(Arena *arena)
+{
+	ArenaBlock *block, *next;
+
+	if (!arena)
+		return;
+	for (block = arena->blocks; block; block = next)
+	{
+		next = block->next;
+		free(block);
+	}
+	map_free(arena->strings);
+	free(arena);
+}
@@ -1,4 +1,5 @@
 #include "utils.h"
+#include "../reporter/reporter.h"
 #include <stdlib.h>
 
 char *extract_username(const char *repo_url)
@@ -33,7 +34,7 @@ int rename_repo(const char *old, const char *new)
 {
 	if (rename(old, new) != 0)
 	{
-		perror("Rename failed");
+		report_perror("Rename failed");
 		return 1;
 	}
 	return 0;
@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <openssl/sha.h>
+#include "utils.h"
+
+/*
+ * Per-run cache of submission files. Each file is stat()ed when a stage
+ * first asks for it and mapped at most once, so the README check, the
+ * validator and the plagiarism hash share one read-only view instead of
+ * reopening and rereading the file. Every lookup re-stat()s the path and
+ * drops the view if size, mtime or inode changed (a student's script may
+ * rewrite its own files). file_cache_clear() ends the run.
+ */
+
+static Arena *cache_arena;
+static HashMap *cache;       /* path -> CachedFile * */
+static CachedFile *entries;  /* every entry, for file_cache_clear() */
+
+static void unmap_file(CachedFile *file)
+{
+	if (file->data)
+		munmap((void *)file->data, file->size);
+	file->data = NULL;
+	file->loaded = 0;
+	file->hash[0] = '\0';
+}
+
+static int same_file(const CachedFile *file, const struct stat *st)
+{
+	return file->size == (size_t)st->st_size && file->ino == st->st_ino &&
+		file->dev == st->st_dev && file->mtime.tv_sec == st->st_mtim.tv_sec &&
+		file->mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+/**
+ * file_cache_stat - Looks a file up without reading it.
+ * @path: File to look up
+ *
+ * Return: The cached entry with an up-to-date size and mtime, NULL if the
+ * file does not exist (errno is set) or on allocation failure
+ */
+CachedFile *file_cache_stat(const char *path)
+{
+	CachedFile **slot, *file;
+	const char *key;
+	struct stat st;
+
+	if (stat(path, &st) != 0)
+		return NULL;
+	if (!cache)
+	{
+		cache_arena = arena_create();
+		cache = cache_arena ? map_create(sizeof(CachedFile *), cache_arena) : NULL;
+		if (!cache)
+			return NULL;
+	}
+
+	slot = map_put(cache, path, &key);
+	if (!slot)
+		return NULL;
+	file = *slot;
+	if (!file)
+	{
+		file = arena_alloc(cache_arena, sizeof(*file));
+		if (!file)
+			return NULL;
+		file->path = key;
+		file->next = entries;
+		entries = file;
+		*slot = file;
+	}
+	else if (same_file(file, &st))
+	{
+		return file;
+	}
+
+	unmap_file(file);
+	file->size = st.st_size;
+	file->mtime = st.st_mtim;
+	file->ino = st.st_ino;
+	file->dev = st.st_dev;
+	file->is_dir = S_ISDIR(st.st_mode);
+	return file;
+}
+
+/**
+ * file_cache_load - Looks a file up and maps its contents.
+ * @path: File to read
+ *
+ * Return: The cached entry, whose data holds size bytes (NULL when the
+ * file is empty), or NULL if the file cannot be read (errno is set)
+ */
+CachedFile *file_cache_load(const char *path)
+{
+	CachedFile *file;
+	void *data;
+	int fd;
+
+	file = file_cache_stat(path);
+	if (!file || file->loaded)
+		return file;
+	if (file->is_dir)
+		return NULL;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	if (file->size > 0)
+	{
+		data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED)
+		{
+			close(fd);
+			return NULL;
+		}
+		file->data = data;
+	}
+	close(fd);
+	file->loaded = 1;
+	return file;
+}
+
+/**
+ * file_cache_hash - SHA-256 of a loaded file, computed once.
+ * @file: Entry returned by file_cache_load()
+ *
+ * Return: Lowercase hex digest
+ */
+const char *file_cache_hash(CachedFile *file)
+{
+	unsigned char digest[SHA256_DIGEST_LENGTH];
+	int i;
+
+	if (!file->hash[0])
+	{
+		SHA256((const unsigned char *)(file->data ? file->data : ""), file->size, digest);
+		for (i = 0; i < SHA256_DIGEST_LENGTH; i++)
+			sprintf(file->hash + i * 2, "%02x", digest[i]);
+	}
+	return file->hash;
+}
+
+/**
+ * file_cache_clear - Unmaps every cached file and forgets them all.
+ */
+void file_cache_clear(void)
+{
+	for (; entries; entries = entries->next)
+		unmap_file(entries);
+	map_free(cache);
+	arena_destroy(cache_arena);
+	cache = NULL;
+	cache_arena = NULL;
+}
@@ -1,5 +1,5 @@
 #include "utils.h"
-#include "../typewriter/typewriter.h"
+#include "../reporter/reporter.h"
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h> 
@@ -13,21 +13,21 @@ int check_task_files(Task *task)
 
 	if (stat(task->expected_path, &st) != 0 || !S_ISDIR(st.st_mode))
 	{
-		fprintf(stderr, "Directory not found: %s\n", task->expected_path);
+		report_error("Directory not found: %s\n", task->expected_path);
 		return 0;
 	}
 
 	for (i = 0; i < task->file_count; i++)
 	{
 		snprintf(filepath, sizeof(filepath), "%s/%s", task->expected_path, task->expected_files[i]);
-		if (stat(filepath, &st) != 0)
+		if (!file_cache_stat(filepath))
 		{
-			fprintf(stderr, "Missing file: %s\n", filepath);
+			report_error("Missing file: %s\n", filepath);
 			return 0;
 		}
 	}
 
 	snprintf(msg, sizeof(msg), "All expected files found in %s\n", task->expected_path);
-	typewrite(20000, "%s", msg);
+	report_progress(20000, "%s", msg);
 	return 1;
 }
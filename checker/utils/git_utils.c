@@ -2,66 +2,330 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <stdlib.h>
-#include "../typewriter/typewriter.h"
+#include <sys/file.h>
+#include "../reporter/reporter.h"
+#include "../trace/trace.h"
+#include "../metrics/metrics.h"
 
-int clone_repo(const char *url, const char *target_dir)
+/* Builds "<cmd...> -- <paths...>" for the sparse-checkout commands */
+static const char **sparse_args(const char *verb, const char *mode, const char **paths,
+		int path_count)
 {
-	int result;
-	char command[1024];
+	const char **args;
+	int n = 0, i;
+
+	args = malloc(sizeof(*args) * (path_count + 5));
+	if (!args)
+		return NULL;
+	args[n++] = "sparse-checkout";
+	args[n++] = verb;
+	if (mode)
+		args[n++] = mode;
+	args[n++] = "--";
+	for (i = 0; i < path_count; i++)
+		args[n++] = paths[i];
+	args[n] = NULL;
+	return args;
+}
+
+/* Adds @paths to the sparse set of @dir, a no-op for full checkouts */
+static int widen_sparse_set(const char *dir, const char **paths, int path_count)
+{
+	char sparse_file[1024];
+	const char **args;
+	int ret;
+
+	snprintf(sparse_file, sizeof(sparse_file), "%s/.git/info/sparse-checkout", dir);
+	if (path_count == 0 || access(sparse_file, F_OK) != 0)
+		return 0;
+
+	args = sparse_args("add", NULL, paths, path_count);
+	if (!args)
+		return 1;
+	TRACE_BEGIN("git_sparse_add", dir);
+	ret = run_git(dir, args);
+	TRACE_END("git_sparse_add");
+	free(args);
+	return ret;
+}
+
+/**
+ * clone_repo - Clones only what the requested tasks need.
+ * @url: Repository to clone
+ * @target_dir: Directory to clone into
+ * @username: Owner of @url, for the shared object store
+ * @paths: Repository-relative task directories to check out
+ * @path_count: Number of entries in @paths, 0 checks out everything
+ *
+ * The clone is shallow (depth 1) and blobless, and with @paths it is a cone
+ * mode sparse checkout: only top-level files and the task directories are
+ * materialised, blobs for anything else are never downloaded. Before the
+ * checkout, store_share() puts the blobs it needs into the shared store,
+ * which the clone borrows them from instead of keeping a copy.
+ *
+ * Return: 0 on success, non-zero otherwise
+ */
+int clone_repo(const char *url, const char *target_dir, const char *username,
+		const char **paths, int path_count)
+{
+	static const char *const checkout_args[] = { "checkout", "-q", NULL };
+	const char *args[12];
+	const char **sparse;
+	int result, lock, n = 0;
+	double start;
 	char message[1024];
 
-	snprintf(command, sizeof(command), "git clone %s %s", url, target_dir);
-	result = system(command);
+	args[n++] = "clone";
+	args[n++] = "--depth";
+	args[n++] = "1";
+	args[n++] = "--filter=blob:none";
+	args[n++] = "--no-checkout";
+	if (path_count > 0)
+		args[n++] = "--sparse";
+	args[n++] = "--";
+	args[n++] = url;
+	args[n++] = target_dir;
+	args[n] = NULL;
+
+	lock = store_lock(LOCK_SH);
+	TRACE_BEGIN("git_clone", url);
+	start = metrics_now();
+	result = run_git(NULL, args);
+	/* Best effort: without the store the checkout downloads its own blobs */
+	if (result == 0 && store_share(target_dir, url, username, paths, path_count) != 0)
+		report_error("Warning: could not update the shared object store.\n");
+	if (result == 0 && path_count > 0)
+	{
+		sparse = sparse_args("set", "--cone", paths, path_count);
+		result = sparse ? run_git(target_dir, sparse) : 1;
+		free(sparse);
+	}
+	if (result == 0)
+		result = run_git(target_dir, checkout_args);
+	metrics_observe(HIST_CLONE, start);
+	TRACE_END("git_clone");
+	store_unlock(lock);
 
 	if (result == 0)
 	{
 		snprintf(message, sizeof(message), "Repository cloned successfully into '%s'\n", target_dir);
-		typewrite(3000, "%s", message);
+		report_progress(3000, "%s", message);
 	}
 
 	return result;
 }
 
-int update_repo(const char *dir)
+/*
+ * Asks the remote for its default branch and head commit without fetching:
+ * "git ls-remote --symref origin HEAD" prints "ref: refs/heads/<b>\tHEAD"
+ * then "<sha>\tHEAD".
+ */
+static int probe_remote(const char *dir, char *branch, size_t branch_size,
+		char *sha, size_t sha_size)
 {
+	static const char *const args[] = { "ls-remote", "--symref", "origin", "HEAD", NULL };
+	char output[1024];
+	char *line, *save, *end;
 	int ret;
 
-	ret = chdir(dir);
+	TRACE_BEGIN("git_probe", dir);
+	ret = run_git_output(dir, args, output, sizeof(output));
+	TRACE_END("git_probe");
 	if (ret != 0)
+		return 1;
+
+	*branch = *sha = '\0';
+	for (line = strtok_r(output, "\n", &save); line; line = strtok_r(NULL, "\n", &save))
 	{
-		perror("chdir");
+		end = strchr(line, '\t');
+		if (!end)
+			continue;
+		*end = '\0';
+		if (strncmp(line, "ref: refs/heads/", 16) == 0)
+			snprintf(branch, branch_size, "%s", line + 16);
+		else
+			snprintf(sha, sha_size, "%s", line);
+	}
+	if (!*branch)
+		snprintf(branch, branch_size, "main");
+	return *sha == '\0';
+}
+
+/*
+ * Non-zero when the work tree has changes, untracked or ignored files.
+ * Bytecode python writes next to the sources while a task runs does not
+ * count, or no clone would ever be clean again.
+ */
+static int is_dirty(const char *dir)
+{
+	static const char *const args[] = {
+		"status", "--porcelain", "--ignored", "--untracked-files=all", "--", ".",
+		":(exclude,glob)**/__pycache__/**", ":(exclude,glob)**/*.pyc", NULL
+	};
+	char output[256];
+
+	if (run_git_output(dir, args, output, sizeof(output)) != 0)
 		return 1;
+	return *output != '\0';
+}
+
+/* Non-zero when every entry of @paths is already in the sparse set of @dir */
+static int sparse_covers(const char *dir, const char **paths, int path_count)
+{
+	static const char *const list_args[] = { "sparse-checkout", "list", NULL };
+	char sparse_file[1024];
+	char listed[8192];
+	const char *line, *next;
+	size_t len;
+	int i, found;
+
+	snprintf(sparse_file, sizeof(sparse_file), "%s/.git/info/sparse-checkout", dir);
+	if (access(sparse_file, F_OK) != 0)
+		return 1;
+	if (run_git_output(dir, list_args, listed, sizeof(listed)) != 0)
+		return 0;
+
+	for (i = 0; i < path_count; i++)
+	{
+		len = strlen(paths[i]);
+		found = 0;
+		for (line = listed; *line && !found; line = next)
+		{
+			next = line + strcspn(line, "\n");
+			found = (size_t)(next - line) == len && strncmp(line, paths[i], len) == 0;
+			if (*next)
+				next++;
+		}
+		if (!found)
+			return 0;
 	}
+	return 1;
+}
 
-	typewrite(20000, "Fetching latest changes...\n");
-	ret = system("git fetch origin");
-	if (ret != 0)
+/**
+ * repo_is_current - Tells whether a clone can be checked without updating.
+ * @dir: Existing clone
+ * @paths: Task directories the check needs
+ * @path_count: Number of entries in @paths
+ * @remote: Receives what the remote reported, for update_repo()
+ *
+ * Only reads the clone, so it is safe under a shared repo_lock().
+ *
+ * Return: 1 if HEAD matches the remote default branch, the tree is clean and
+ * every path is checked out; 0 if update_repo() has work to do
+ */
+int repo_is_current(const char *dir, const char **paths, int path_count, RemoteHead *remote)
+{
+	static const char *const head_args[] = { "rev-parse", "HEAD", NULL };
+	char local_sha[128];
+
+	if (probe_remote(dir, remote->branch, sizeof(remote->branch),
+				remote->sha, sizeof(remote->sha)) != 0)
 	{
-		fprintf(stderr, "git fetch failed.\n");
-		return 1;
+		*remote->sha = '\0';
+		return 0;
 	}
+	if (run_git_output(dir, head_args, local_sha, sizeof(local_sha)) != 0)
+		return 0;
+	return strcmp(remote->sha, local_sha) == 0 && !is_dirty(dir) &&
+		sparse_covers(dir, paths, path_count);
+}
+
+static int git_step(const char *dir, const char *trace_name, const char *const args[],
+		const char *error)
+{
+	int ret;
 
-	typewrite(20000, "Resetting to origin/main...\n");
-	ret = system("git reset --hard origin/main");
+	TRACE_BEGIN(trace_name, dir);
+	ret = run_git(dir, args);
+	TRACE_END(trace_name);
 	if (ret != 0)
+		report_error("%s\n", error);
+	return ret;
+}
+
+/**
+ * update_repo - Brings an existing clone up to date with its remote.
+ * @dir: Clone to update, git runs with -C so the process cwd never changes
+ * @paths: Task directories that must be checked out
+ * @path_count: Number of entries in @paths
+ * @remote: Remote head repo_is_current() already probed, or one with an
+ *          empty sha to have update_repo() run ls-remote itself
+ *
+ * The sparse set is widened to @paths first. The remote head then tells
+ * whether the remote default branch still points at HEAD: if so fetch and
+ * reset are skipped entirely. Otherwise the branch (whatever its name) is
+ * fetched shallow and reset to. git clean only runs when the work tree is
+ * actually dirty.
+ *
+ * Return: 0 on success, 1 on failure
+ */
+int update_repo(const char *dir, const char **paths, int path_count, RemoteHead *remote)
+{
+	static const char *const head_args[] = { "rev-parse", "HEAD", NULL };
+	static const char *const clean_args[] = { "clean", "-fdx", NULL };
+	const char *fetch_args[] = { "fetch", "--depth", "1", "origin", NULL, NULL };
+	const char *reset_args[] = { "reset", "--hard", NULL, NULL };
+	char local_sha[128];
+	char refspec[600], target[300];
+	double start;
+	int ret, lock, up_to_date;
+
+	if (widen_sparse_set(dir, paths, path_count) != 0)
 	{
-		fprintf(stderr, "git reset failed.\n");
+		report_error("git sparse-checkout add failed.\n");
 		return 1;
 	}
 
-	typewrite(20000, "Cleaning working directory...\n");
-	ret = system("git clean -fdx");
-	if (ret != 0)
+	if (!*remote->sha && probe_remote(dir, remote->branch, sizeof(remote->branch),
+				remote->sha, sizeof(remote->sha)) != 0)
 	{
-		fprintf(stderr, "git clean failed.\n");
+		report_error("git ls-remote failed.\n");
 		return 1;
 	}
+	if (run_git_output(dir, head_args, local_sha, sizeof(local_sha)) != 0)
+		*local_sha = '\0';
 
-	ret = chdir("..");
-	if (ret != 0)
+	up_to_date = strcmp(remote->sha, local_sha) == 0;
+	if (up_to_date)
 	{
-		perror("chdir back");
-		return 1;
+		report_progress(20000, "Already up to date with origin/%s.\n", remote->branch);
+		reset_args[2] = "HEAD";
+	}
+	else
+	{
+		report_progress(20000, "Fetching latest changes...\n");
+		snprintf(refspec, sizeof(refspec), "+refs/heads/%s:refs/remotes/origin/%s",
+				remote->branch, remote->branch);
+		fetch_args[4] = refspec;
+		lock = store_lock(LOCK_SH);
+		TRACE_BEGIN("git_fetch", dir);
+		start = metrics_now();
+		ret = run_git(dir, fetch_args);
+		metrics_observe(HIST_FETCH, start);
+		TRACE_END("git_fetch");
+		store_unlock(lock);
+		if (ret != 0)
+		{
+			report_error("git fetch failed.\n");
+			return 1;
+		}
+
+		snprintf(target, sizeof(target), "origin/%s", remote->branch);
+		reset_args[2] = target;
+		report_progress(20000, "Resetting to %s...\n", target);
+		if (git_step(dir, "git_reset", reset_args, "git reset failed.") != 0)
+			return 1;
+	}
+
+	if (is_dirty(dir))
+	{
+		report_progress(20000, "Cleaning working directory...\n");
+		/* Tracked files may be modified too; a fresh reset already restored them */
+		if (up_to_date && git_step(dir, "git_reset", reset_args, "git reset failed.") != 0)
+			return 1;
+		if (git_step(dir, "git_clean", clean_args, "git clean failed.") != 0)
+			return 1;
 	}
 
 	return 0;
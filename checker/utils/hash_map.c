@@ -0,0 +1,315 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "utils.h"
+
+/*
+ * Open-addressing string map in the style of a Swiss table. A control byte
+ * per slot holds either CTRL_EMPTY or the low 7 bits of the key's hash, so
+ * a probe compares a whole group of GROUP_WIDTH slots at once (one SSE2
+ * compare where available) and only touches a slot whose byte matched.
+ * Slots keep the full hash next to the key, so mismatches rarely reach
+ * strcmp() and resizing never rehashes a string. Values of a fixed size
+ * are stored inline after the slot header; keys are copied into an arena.
+ *
+ * There is no removal: every map in the checker is filled once and read.
+ */
+
+#define GROUP_WIDTH 16
+#define MIN_CAPACITY 16
+#define CTRL_EMPTY 0x80
+
+typedef struct {
+	const char *key;
+	uint32_t hash;
+} SlotHeader;
+
+struct HashMap {
+	unsigned char *ctrl;   /* capacity + GROUP_WIDTH bytes, the tail mirrors the head */
+	char *slots;           /* capacity * slot_size bytes */
+	size_t slot_size;
+	size_t value_size;
+	size_t capacity;       /* power of two */
+	size_t count;
+	size_t growth_left;    /* inserts before the 7/8 load limit */
+	Arena *keys;
+	int owns_keys;
+};
+
+#define VALUE_OFFSET ((sizeof(SlotHeader) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+#define SLOT(map, i) ((SlotHeader *)((map)->slots + (i) * (map)->slot_size))
+
+/**
+ * map_hash - Hashes a string key.
+ * @key: NUL-terminated key
+ *
+ * Return: FNV-1a hash with a murmur3 finaliser, so the 7 bits kept in the
+ * control bytes are as well mixed as the rest
+ */
+uint32_t map_hash(const char *key)
+{
+	uint32_t h = 2166136261u;
+
+	while (*key)
+	{
+		h ^= (unsigned char)*key++;
+		h *= 16777619u;
+	}
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+/* Bit i set for every byte of the group at @ctrl equal to @byte */
+static unsigned int group_match(const unsigned char *ctrl, unsigned char byte)
+{
+#ifdef __SSE2__
+	__m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+
+	return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)byte)));
+#else
+	unsigned int mask = 0;
+	int i;
+
+	for (i = 0; i < GROUP_WIDTH; i++)
+		mask |= (unsigned int)(ctrl[i] == byte) << i;
+	return mask;
+#endif
+}
+
+static unsigned int lowest_bit(unsigned int mask)
+{
+#ifdef __GNUC__
+	return (unsigned int)__builtin_ctz(mask);
+#else
+	unsigned int bit = 0;
+
+	while (!(mask & 1))
+	{
+		mask >>= 1;
+		bit++;
+	}
+	return bit;
+#endif
+}
+
+static int map_alloc(HashMap *map, size_t capacity)
+{
+	map->ctrl = malloc(capacity + GROUP_WIDTH);
+	map->slots = malloc(capacity * map->slot_size);
+	if (!map->ctrl || !map->slots)
+	{
+		free(map->ctrl);
+		free(map->slots);
+		return 1;
+	}
+	memset(map->ctrl, CTRL_EMPTY, capacity + GROUP_WIDTH);
+	map->capacity = capacity;
+	map->growth_left = capacity - capacity / 8 - map->count;
+	return 0;
+}
+
+static void set_ctrl(HashMap *map, size_t i, unsigned char byte)
+{
+	map->ctrl[i] = byte;
+	/* Keep the mirrored head in sync so a group read may run off the end */
+	if (i < GROUP_WIDTH)
+		map->ctrl[map->capacity + i] = byte;
+}
+
+/* First empty slot on @hash's probe sequence; the map is never full */
+static size_t find_empty(const HashMap *map, uint32_t hash)
+{
+	size_t mask = map->capacity - 1, pos = (hash >> 7) & mask, step = 0;
+	unsigned int empty;
+
+	for (;;)
+	{
+		empty = group_match(map->ctrl + pos, CTRL_EMPTY);
+		if (empty)
+			return (pos + lowest_bit(empty)) & mask;
+		step += GROUP_WIDTH;
+		pos = (pos + step) & mask;
+	}
+}
+
+static long find_slot(const HashMap *map, const char *key, uint32_t hash)
+{
+	size_t mask = map->capacity - 1, pos = (hash >> 7) & mask, step = 0, i;
+	unsigned int match;
+	SlotHeader *slot;
+
+	for (;;)
+	{
+		match = group_match(map->ctrl + pos, hash & 0x7f);
+		while (match)
+		{
+			i = (pos + lowest_bit(match)) & mask;
+			slot = SLOT(map, i);
+			if (slot->hash == hash && strcmp(slot->key, key) == 0)
+				return (long)i;
+			match &= match - 1;
+		}
+		if (group_match(map->ctrl + pos, CTRL_EMPTY))
+			return -1;
+		step += GROUP_WIDTH;
+		pos = (pos + step) & mask;
+	}
+}
+
+static int map_resize(HashMap *map)
+{
+	unsigned char *old_ctrl = map->ctrl;
+	char *old_slots = map->slots;
+	size_t old_capacity = map->capacity, i, j;
+	SlotHeader *slot;
+
+	if (map_alloc(map, old_capacity * 2) != 0)
+	{
+		map->ctrl = old_ctrl;
+		map->slots = old_slots;
+		return 1;
+	}
+	for (i = 0; i < old_capacity; i++)
+	{
+		if (old_ctrl[i] & CTRL_EMPTY)
+			continue;
+		slot = (SlotHeader *)(old_slots + i * map->slot_size);
+		j = find_empty(map, slot->hash);
+		set_ctrl(map, j, old_ctrl[i]);
+		memcpy(SLOT(map, j), slot, map->slot_size);
+	}
+	free(old_ctrl);
+	free(old_slots);
+	return 0;
+}
+
+/**
+ * map_create - Creates an empty map.
+ * @value_size: Bytes stored per key, 0 for a set
+ * @keys: Arena key copies are allocated from, NULL for one owned by the map
+ *
+ * Return: New map, NULL on allocation failure
+ */
+HashMap *map_create(size_t value_size, Arena *keys)
+{
+	HashMap *map;
+
+	map = calloc(1, sizeof(*map));
+	if (!map)
+		return NULL;
+	map->value_size = value_size;
+	map->slot_size = (VALUE_OFFSET + value_size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+	map->keys = keys ? keys : arena_create();
+	map->owns_keys = !keys;
+	if (!map->keys || map_alloc(map, MIN_CAPACITY) != 0)
+	{
+		if (map->owns_keys)
+			arena_destroy(map->keys);
+		free(map);
+		return NULL;
+	}
+	return map;
+}
+
+/**
+ * map_get - Looks a key up.
+ * @map: Map to search
+ * @key: Key to find
+ *
+ * Return: The key's value storage, NULL if the key is absent
+ */
+void *map_get(const HashMap *map, const char *key)
+{
+	long i;
+
+	i = find_slot(map, key, map_hash(key));
+	return i < 0 ? NULL : (char *)SLOT(map, i) + VALUE_OFFSET;
+}
+
+/**
+ * map_put - Finds or inserts a key.
+ * @map: Map to update
+ * @key: Key to insert; it is copied unless already present
+ * @stored_key: If not NULL, receives the map's copy of the key
+ *
+ * Return: The key's value storage, zeroed for a new key, or NULL on
+ * allocation failure. The pointer is valid until the next insert.
+ */
+void *map_put(HashMap *map, const char *key, const char **stored_key)
+{
+	uint32_t hash = map_hash(key);
+	SlotHeader *slot;
+	const char *copy;
+	long i;
+
+	i = find_slot(map, key, hash);
+	if (i < 0)
+	{
+		if (map->growth_left == 0 && map_resize(map) != 0)
+			return NULL;
+		copy = arena_strdup(map->keys, key);
+		if (!copy)
+			return NULL;
+		i = (long)find_empty(map, hash);
+		set_ctrl(map, i, hash & 0x7f);
+		slot = SLOT(map, i);
+		slot->key = copy;
+		slot->hash = hash;
+		memset((char *)slot + VALUE_OFFSET, 0, map->value_size);
+		map->count++;
+		map->growth_left--;
+	}
+	if (stored_key)
+		*stored_key = SLOT(map, i)->key;
+	return (char *)SLOT(map, i) + VALUE_OFFSET;
+}
+
+/**
+ * map_add - Adds a key to a set.
+ * @set: Map used as a set
+ * @key: Key to add
+ *
+ * Return: 1 if @key was new, 0 if it was already there, -1 on allocation
+ * failure
+ */
+int map_add(HashMap *set, const char *key)
+{
+	size_t before = set->count;
+
+	if (!map_put(set, key, NULL))
+		return -1;
+	return set->count > before;
+}
+
+/**
+ * map_count - Number of keys in a map.
+ * @map: Map to count
+ *
+ * Return: Number of keys
+ */
+size_t map_count(const HashMap *map)
+{
+	return map->count;
+}
+
+/**
+ * map_free - Releases a map, and its keys unless they live in a caller's arena.
+ * @map: Map to release, may be NULL
+ */
+void map_free(HashMap *map)
+{
+	if (!map)
+		return;
+	if (map->owns_keys)
+		arena_destroy(map->keys);
+	free(map->ctrl);
+	free(map->slots);
+	free(map);
+}
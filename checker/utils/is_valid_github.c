@@ -1,4 +1,5 @@
 #include "utils.h"
+#include "../reporter/reporter.h"
 #include <regex.h>
 
 int is_valid_git_url(const char *url)
@@ -11,14 +12,14 @@ int is_valid_git_url(const char *url)
 
 	if (url == NULL)
 	{
-		fprintf(stderr, "Error: NULL URL provided.\n");
+		report_error("Error: NULL URL provided.\n");
 		return 0;
 	}
 
 	ret = regcomp(&regex, pattern, REG_EXTENDED | REG_NOSUB);
 	if (ret != 0)
 	{
-		fprintf(stderr, "Error: Failed to compile regex.\n");
+		report_error("Error: Failed to compile regex.\n");
 		return 0;
 	}
 
@@ -27,11 +28,9 @@ int is_valid_git_url(const char *url)
 
 	if (ret != 0)
 	{
-		fprintf(stderr,
-			"Error: Invalid Git repository URL: '%s'\n"
-			"Hint: Make sure the URL ends with '.git', like:\n"
-			"  https://github.com/user/repo.git\n",
-			url);
+		report_error("Error: Invalid Git repository URL: '%s'\n"
+				"Hint: Make sure the URL ends with '.git', like:\n"
+				"  https://github.com/user/repo.git\n", url);
 		return 0;
 	}
 
@@ -0,0 +1,49 @@
+#include "utils.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+
+/**
+ * lock_path - Takes an advisory flock() on a lock file, creating it.
+ * @path: Lock file
+ * @operation: LOCK_SH or LOCK_EX, optionally | LOCK_NB
+ *
+ * Return: Descriptor to pass to unlock_path(), -1 on failure
+ */
+int lock_path(const char *path, int operation)
+{
+	int fd;
+
+	fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+		return -1;
+	if (flock(fd, operation) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+void unlock_path(int fd)
+{
+	if (fd < 0)
+		return;
+	flock(fd, LOCK_UN);
+	close(fd);
+}
+
+/**
+ * repo_lock - Locks one workspace through "<repo_dir>.lock".
+ * @repo_dir: The cloned_repo_<user> directory, which need not exist yet
+ * @operation: LOCK_SH to read a stable checkout, LOCK_EX to clone or update
+ *
+ * Return: Descriptor to pass to unlock_path(), -1 on failure
+ */
+int repo_lock(const char *repo_dir, int operation)
+{
+	char path[512];
+
+	snprintf(path, sizeof(path), "%s.lock", repo_dir);
+	return lock_path(path, operation);
+}
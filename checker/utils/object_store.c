@@ -0,0 +1,400 @@
+#include "utils.h"
+#include <stdlib.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "../reporter/reporter.h"
+#include "../trace/trace.h"
+
+/*
+ * Shared object store: one bare repository under cache/ that every student
+ * clone borrows objects from through git alternates. It holds the blobs
+ * fresh clones check out, fetched once whatever the number of students
+ * sharing them. Blobs are fetched by id without a filter, so the store is
+ * an ordinary repository that git gc can prune. They stay reachable from
+ * refs/users/<user>/HEAD, a commit of a flat tree listing the blobs that
+ * student's checkout uses, which store_forget() deletes with the
+ * workspace. Checks hold the lock file shared while they fetch into or
+ * clone from the store; store_gc() takes it exclusive so it never repacks
+ * under a running clone.
+ */
+
+#define STORE_FETCH_BATCH 48
+
+/* Creates the bare store once; git's own auto-gc is off, see store_gc() */
+static int store_init(void)
+{
+	static const char *const init_args[] = {
+		"init", "-q", "--bare", OBJECT_STORE ".tmp", NULL
+	};
+	static const char *const config_args[] = { "config", "gc.auto", "0", NULL };
+	int fd, ret = 0;
+
+	if (access(OBJECT_STORE, F_OK) == 0)
+		return 0;
+
+	fd = lock_path(OBJECT_STORE_LOCK, LOCK_EX);
+	if (access(OBJECT_STORE, F_OK) != 0)
+	{
+		ret = run_git(NULL, init_args);
+		if (ret == 0)
+			ret = run_git(OBJECT_STORE ".tmp", config_args);
+		if (ret == 0)
+			ret = rename(OBJECT_STORE ".tmp", OBJECT_STORE);
+	}
+	store_unlock(fd);
+	return ret;
+}
+
+/**
+ * store_lock - Locks the object store.
+ * @operation: LOCK_SH for fetches and clones, LOCK_EX for maintenance
+ *
+ * A shared lock creates the store first if it does not exist yet, since
+ * creating it needs the lock exclusive.
+ *
+ * Return: Lock file descriptor for store_unlock(), -1 on failure
+ */
+int store_lock(int operation)
+{
+	mkdir(CACHE_DIR, 0755);
+	if (operation & LOCK_SH)
+		store_init();
+	return lock_path(OBJECT_STORE_LOCK, operation);
+}
+
+void store_unlock(int fd)
+{
+	unlock_path(fd);
+}
+
+/* Whether cone mode checks out @path for the directories in @paths */
+static int in_cone(const char *path, const char **paths, int path_count)
+{
+	const char *slash;
+	size_t len, dir_len;
+	int i;
+
+	slash = strrchr(path, '/');
+	if (path_count == 0 || !slash)
+		return 1;
+	dir_len = slash - path;
+	for (i = 0; i < path_count; i++)
+	{
+		len = strlen(paths[i]);
+		while (len > 0 && paths[i][len - 1] == '/')
+			len--;
+		/* Inside the directory, or directly in one of its parents */
+		if (strncmp(path, paths[i], len) == 0 && path[len] == '/')
+			return 1;
+		if (dir_len < len && strncmp(paths[i], path, dir_len) == 0 && paths[i][dir_len] == '/')
+			return 1;
+	}
+	return 0;
+}
+
+/* Lets @repo_dir read objects from the store, whose path must be absolute */
+static int add_alternate(const char *repo_dir)
+{
+	char store[PATH_MAX], path[PATH_MAX + 64];
+	FILE *fp;
+	int ok;
+
+	if (!realpath(OBJECT_STORE "/objects", store))
+		return 1;
+	snprintf(path, sizeof(path), "%s/.git/objects/info/alternates", repo_dir);
+	fp = fopen(path, "a");
+	if (!fp)
+		return 1;
+	fprintf(fp, "%s\n", store);
+	ok = !ferror(fp);
+	return fclose(fp) == 0 && ok ? 0 : 1;
+}
+
+/* Fetches @count blobs by id from @url into the store, STORE_FETCH_BATCH at a time */
+static int fetch_blobs(const char *url, const char **ids, int count)
+{
+	const char *args[STORE_FETCH_BATCH + 11];
+	int i, n, fixed, ret = 0;
+
+	n = 0;
+	/* No haves: the store has no commit of @url that covers these blobs */
+	args[n++] = "-c";
+	args[n++] = "fetch.negotiationAlgorithm=noop";
+	args[n++] = "fetch";
+	args[n++] = "-q";
+	args[n++] = "--no-tags";
+	args[n++] = "--no-write-fetch-head";
+	/* A plain URL and no --filter: nothing promisor, nothing in the config */
+	args[n++] = "--";
+	args[n++] = url;
+	fixed = n;
+	for (i = 0; i < count && ret == 0; i += STORE_FETCH_BATCH)
+	{
+		for (n = fixed; n - fixed < STORE_FETCH_BATCH && i + n - fixed < count; n++)
+			args[n] = ids[i + n - fixed];
+		args[n] = NULL;
+		ret = run_git(OBJECT_STORE, args);
+	}
+	return ret;
+}
+
+/* Moves the ids the store lacks to the front of @ids, returns how many */
+static int store_lacks(const char **ids, int count)
+{
+	static const char *const check_args[] = { "cat-file", "--batch-check", NULL };
+	const char *swap;
+	char *output = NULL, *line, *next;
+	HashMap *absent;
+	FILE *listing;
+	int i, missing = -1;
+
+	listing = tmpfile();
+	absent = map_create(0, NULL);
+	if (!listing || !absent)
+		goto out;
+	for (i = 0; i < count; i++)
+		fprintf(listing, "%s\n", ids[i]);
+	if (ferror(listing) || run_git_read(OBJECT_STORE, check_args, listing, &output) != 0)
+		goto out;
+	/* An object the store does not have comes back as "<id> missing" */
+	for (line = output; *line; line = next)
+	{
+		next = strchr(line, '\n');
+		if (next)
+			*next++ = '\0';
+		else
+			next = line + strlen(line);
+		if (strlen(line) > 8 && strcmp(line + strlen(line) - 8, " missing") == 0)
+		{
+			line[strlen(line) - 8] = '\0';
+			map_add(absent, line);
+		}
+	}
+	missing = 0;
+	for (i = 0; i < count; i++)
+	{
+		if (!map_get(absent, ids[i]))
+			continue;
+		swap = ids[missing];
+		ids[missing++] = ids[i];
+		ids[i] = swap;
+	}
+out:
+	map_free(absent);
+	free(output);
+	if (listing)
+		fclose(listing);
+	return missing;
+}
+
+/*
+ * Lists the blobs the checkout of @repo_dir uses, once each, as pointers
+ * into *@tree; the first *@missing of them are not in the store yet. The
+ * caller frees both the list and *@tree.
+ *
+ * Return: The list, NULL if the clone or the store could not be read
+ */
+static const char **cone_blobs(const char *repo_dir, const char **paths, int path_count,
+		char **tree, int *count, int *missing)
+{
+	static const char *const tree_args[] = { "ls-tree", "-r", "HEAD", NULL };
+	const char **ids = NULL, **grown;
+	char *line, *next, *id, *tab;
+	HashMap *listed;
+	int capacity = 1;
+
+	*count = *missing = 0;
+	listed = map_create(0, NULL);
+	ids = malloc(capacity * sizeof(*ids));
+	if (!listed || !ids || run_git_read(repo_dir, tree_args, NULL, tree) != 0)
+		goto fail;
+
+	/* ls-tree lines are "<mode> blob <id>\t<path>" */
+	for (line = *tree; *line; line = next)
+	{
+		next = strchr(line, '\n');
+		if (next)
+			*next++ = '\0';
+		else
+			next = line + strlen(line);
+		id = strstr(line, " blob ");
+		tab = strchr(line, '\t');
+		if (!id || !tab || tab < id)
+			continue;
+		id += 6;
+		*tab = '\0';
+		/* A blob checked out at two paths is only listed once */
+		if (!in_cone(tab + 1, paths, path_count) || map_add(listed, id) != 1)
+			continue;
+		if (*count == capacity)
+		{
+			capacity *= 2;
+			grown = realloc(ids, capacity * sizeof(*ids));
+			if (!grown)
+				goto fail;
+			ids = grown;
+		}
+		ids[(*count)++] = id;
+	}
+	*missing = store_lacks(ids, *count);
+	if (*missing < 0)
+		goto fail;
+	map_free(listed);
+	return ids;
+fail:
+	map_free(listed);
+	free(ids);
+	free(*tree);
+	*tree = NULL;
+	*count = *missing = 0;
+	return NULL;
+}
+
+/*
+ * Points refs/users/@username/HEAD at a commit of one flat tree naming
+ * each of @ids after itself, which keeps the blobs reachable in the store
+ */
+static int record_blobs(const char *username, const char **ids, int count)
+{
+	const char *mktree_args[] = { "mktree", NULL };
+	const char *commit_args[] = {
+		"-c", "user.name=checker", "-c", "user.email=checker@localhost",
+		"commit-tree", "-m", NULL, NULL, NULL
+	};
+	const char *ref_args[] = { "update-ref", NULL, NULL, NULL };
+	char tree[128], commit[128], ref[512];
+	FILE *listing;
+	int i, ret;
+
+	listing = tmpfile();
+	if (!listing)
+		return 1;
+	for (i = 0; i < count; i++)
+		fprintf(listing, "100644 blob %s\t%s\n", ids[i], ids[i]);
+	ret = ferror(listing) ? 1 : run_git_filter(OBJECT_STORE, mktree_args, listing,
+			tree, sizeof(tree));
+	fclose(listing);
+	if (ret != 0 || !*tree)
+		return 1;
+
+	commit_args[6] = username;
+	commit_args[7] = tree;
+	if (run_git_output(OBJECT_STORE, commit_args, commit, sizeof(commit)) != 0 || !*commit)
+		return 1;
+	snprintf(ref, sizeof(ref), "refs/users/%s/HEAD", username);
+	ref_args[1] = ref;
+	ref_args[2] = commit;
+	return run_git(OBJECT_STORE, ref_args);
+}
+
+/**
+ * store_share - Shares a fresh clone's checkout with the object store.
+ * @repo_dir: Clone made with --no-checkout, not checked out yet
+ * @url: Repository it was cloned from
+ * @username: Owner of @url, names its refs/users/<user>/HEAD
+ * @paths: Directories the checkout will hold, as for clone_repo()
+ * @path_count: Number of entries in @paths, 0 for everything
+ *
+ * The clone borrows from the store through alternates. Blobs its checkout
+ * needs that the store lacks, and only those, are fetched by id from @url
+ * into the store, so content students share (the template) is downloaded
+ * and stored once; refs/users/@username/HEAD then keeps all of them alive.
+ * Any blob still missing is fetched by the clone itself as usual. Called
+ * with the store locked shared.
+ *
+ * Return: 0 on success, non-zero if the store could not be used
+ */
+int store_share(const char *repo_dir, const char *url, const char *username,
+		const char **paths, int path_count)
+{
+	const char **ids;
+	char *tree;
+	int count, missing, ret;
+
+	if (add_alternate(repo_dir) != 0)
+		return 1;
+
+	TRACE_BEGIN("store_fetch", username);
+	tree = NULL;
+	ids = cone_blobs(repo_dir, paths, path_count, &tree, &count, &missing);
+	ret = ids ? 0 : 1;
+	if (ret == 0 && missing > 0)
+		ret = fetch_blobs(url, ids, missing);
+	if (ret == 0)
+		ret = record_blobs(username, ids, count);
+	free(ids);
+	free(tree);
+	TRACE_END("store_fetch");
+	return ret;
+}
+
+/**
+ * store_forget - Lets the store drop a student's blobs.
+ * @username: Student whose workspace was removed
+ *
+ * Deletes refs/users/@username/HEAD; the next store_gc() prunes whatever
+ * no other student's checkout uses.
+ *
+ * Return: 0 on success or if there is no store, non-zero otherwise
+ */
+int store_forget(const char *username)
+{
+	const char *args[] = { "update-ref", "-d", NULL, NULL };
+	char ref[512];
+	int fd, ret;
+
+	if (access(OBJECT_STORE, F_OK) != 0)
+		return 0;
+	snprintf(ref, sizeof(ref), "refs/users/%s/HEAD", username);
+	args[2] = ref;
+	fd = store_lock(LOCK_SH);
+	ret = run_git(OBJECT_STORE, args);
+	store_unlock(fd);
+	return ret;
+}
+
+/**
+ * store_gc - Compacts the shared object store.
+ *
+ * Repacks everything into one pack and prunes, at once, the blobs no
+ * student's ref uses any more: a workspace keeps its ref until it is
+ * evicted, and clones in progress hold the lock, so nothing still needs
+ * them. Waits for running checks to release the store first.
+ *
+ * Return: 0 on success, non-zero otherwise
+ */
+int store_gc(void)
+{
+	static const char *const pack_refs_args[] = { "pack-refs", "--all", NULL };
+	static const char *const gc_args[] = { "gc", "--quiet", "--prune=now", NULL };
+	int fd, ret;
+
+	if (access(OBJECT_STORE, F_OK) != 0)
+	{
+		report_info("No object store at %s, nothing to collect.\n", OBJECT_STORE);
+		return 0;
+	}
+
+	fd = store_lock(LOCK_EX);
+	if (fd < 0)
+	{
+		report_perror(OBJECT_STORE_LOCK);
+		return 1;
+	}
+
+	report_info("Compacting object store %s...\n", OBJECT_STORE);
+	TRACE_BEGIN("store_gc", OBJECT_STORE);
+	ret = run_git(OBJECT_STORE, pack_refs_args);
+	if (ret == 0)
+		ret = run_git(OBJECT_STORE, gc_args);
+	TRACE_END("store_gc");
+	store_unlock(fd);
+
+	if (ret != 0)
+		report_error("git gc failed on %s\n", OBJECT_STORE);
+	else
+		report_info("Object store compacted.\n");
+	return ret;
+}
@@ -1,4 +1,7 @@
 #include "utils.h"
+#include "../reporter/reporter.h"
+#include "../trace/trace.h"
+#include "../metrics/metrics.h"
 #include <ctype.h>
 #define MAX_OUTPUT 4096
 
@@ -14,9 +17,13 @@ int check_output(const char *script_path, const char *expected_string) {
 	char expected_copy[MAX_OUTPUT];
 	char full_output[MAX_OUTPUT] = "";
 	FILE *fp;
+	double start;
 
+	TRACE_BEGIN("run_main", script_path);
+	start = metrics_now();
 	if ((fp = popen(script_path, "r")) == NULL) {
-		fprintf(stderr, "Error running script: %s\n", script_path);
+		TRACE_END("run_main");
+		report_error("Error running script: %s\n", script_path);
 		return 1;
 	}
 
@@ -24,6 +31,8 @@ int check_output(const char *script_path, const char *expected_string) {
 		strncat(full_output, buffer, MAX_OUTPUT - strlen(full_output) - 1);
 	}
 	pclose(fp);
+	metrics_observe(HIST_EXECUTION, start);
+	TRACE_END("run_main");
 
 	trim_trailing_whitespace(full_output);
 	strncpy(expected_copy, expected_string, MAX_OUTPUT - 1);
@@ -31,12 +40,12 @@ int check_output(const char *script_path, const char *expected_string) {
 	trim_trailing_whitespace(expected_copy);
 
 	if (strcmp(full_output, expected_copy) == 0) {
-		printf("Output matches expected result.\n");
+		report_info("Output matches expected result.\n");
 		return 0;
 	} else {
-		fprintf(stderr, "Output did NOT match expected result.\n");
-		fprintf(stderr, "Got:\n%s\n", full_output);
-		fprintf(stderr, "Expected:\n%s\n", expected_copy);
+		report_error("Output did NOT match expected result.\n");
+		report_error("Got:\n%s\n", full_output);
+		report_error("Expected:\n%s\n", expected_copy);
 		return 1;
 	}
 }
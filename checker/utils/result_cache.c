@@ -0,0 +1,227 @@
+#include "utils.h"
+#include <stdlib.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <openssl/sha.h>
+#include "../reporter/reporter.h"
+#include "../validators/validators.h"
+
+/*
+ * Persistent task results. An entry is keyed by the git tree id of the
+ * task directory, a hash of the task's catalog definition,
+ * VALIDATOR_VERSION, the loaded plugin set and the linters' identity, so it
+ * is reused only while neither the submission, the task nor the checks have
+ * changed. Entries live in RESULT_CACHE as
+ * "<status> <stage>\n" followed by the report_record() stream of the run.
+ * Hits refresh the entry's mtime; result_cache_prune() removes the least
+ * recently used entries once the directory outgrows RESULT_CACHE_BUDGET_MB.
+ */
+
+typedef struct {
+	char name[RESULT_KEY_LENGTH];
+	long mtime;
+	long size;
+} CacheEntry;
+
+int result_cache_enabled = 1;
+
+static void hash_field(SHA256_CTX *sha, const char *value)
+{
+	if (value)
+		SHA256_Update(sha, value, strlen(value));
+	/* Field separator, so ("ab", "c") and ("a", "bc") differ */
+	SHA256_Update(sha, "", 1);
+}
+
+/**
+ * result_cache_key - Computes the cache key of a checked-out task.
+ * @task: Task whose expected_path is inside a git work tree
+ * @key: Receives RESULT_KEY_LENGTH bytes of lowercase hex
+ *
+ * Return: 0 on success, 1 if caching is off or the tree id is unknown
+ */
+int result_cache_key(const Task *task, char *key)
+{
+	static const char *const tree_args[] = { "rev-parse", "HEAD:./", NULL };
+	unsigned char digest[SHA256_DIGEST_LENGTH];
+	char tree[128], plugins[16];
+	SHA256_CTX sha;
+	int i;
+
+	if (!result_cache_enabled || !task->expected_path)
+		return 1;
+	/* HEAD:./ is the tree of the directory git runs in, i.e. the task's */
+	if (run_git_output(task->expected_path, tree_args, tree, sizeof(tree)) != 0 || !*tree)
+		return 1;
+
+	SHA256_Init(&sha);
+	hash_field(&sha, tree);
+	hash_field(&sha, VALIDATOR_VERSION);
+	snprintf(plugins, sizeof(plugins), "%08x", (unsigned int)plugins_signature());
+	hash_field(&sha, plugins);
+	hash_field(&sha, lint_cache_identity());
+	hash_field(&sha, task->task_name);
+	/* The recorded messages name the checkout, so entries are per student */
+	hash_field(&sha, task->expected_path);
+	hash_field(&sha, task->main_file);
+	hash_field(&sha, task->target_file);
+	hash_field(&sha, task->expected_output);
+	hash_field(&sha, task->rules ? task->rules : "");
+	for (i = 0; i < task->file_count; i++)
+		hash_field(&sha, task->expected_files[i]);
+	SHA256_Final(digest, &sha);
+
+	for (i = 0; i < SHA256_DIGEST_LENGTH; i++)
+		sprintf(key + i * 2, "%02x", digest[i]);
+	key[SHA256_DIGEST_LENGTH * 2] = '\0';
+	return 0;
+}
+
+/**
+ * result_cache_open - Looks up a stored result.
+ * @key: From result_cache_key()
+ * @status: Receives the stored ValidationStatus
+ * @stage: Receives the stored CheckStage
+ *
+ * Return: Stream positioned at the recorded messages for report_replay(),
+ * NULL on a miss
+ */
+FILE *result_cache_open(const char *key, int *status, int *stage)
+{
+	char path[512];
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/%s", RESULT_CACHE, key);
+	fp = fopen(path, "r");
+	if (!fp)
+		return NULL;
+	/* Recently used entries are the last to be evicted */
+	utime(path, NULL);
+	if (fscanf(fp, "%d %d", status, stage) != 2 || fgetc(fp) != '\n')
+	{
+		fclose(fp);
+		return NULL;
+	}
+	return fp;
+}
+
+/**
+ * result_cache_store - Saves a result for later runs.
+ * @key: From result_cache_key()
+ * @record: Stream that report_record() wrote the run's messages to
+ * @status: Outcome of the run
+ * @stage: Stage the run stopped at
+ *
+ * The entry is written to a temporary file and renamed into place, so
+ * concurrent readers see either no entry or a complete one.
+ *
+ * Return: 0 on success, 1 otherwise
+ */
+int result_cache_store(const char *key, FILE *record, int status, int stage)
+{
+	char path[512], tmp[600];
+	char buffer[4096];
+	size_t n;
+	FILE *fp;
+	int ok;
+
+	mkdir(CACHE_DIR, 0755);
+	mkdir(RESULT_CACHE, 0755);
+	snprintf(path, sizeof(path), "%s/%s", RESULT_CACHE, key);
+	snprintf(tmp, sizeof(tmp), "%s/%s.%ld.tmp", RESULT_CACHE, key, (long)getpid());
+
+	fp = fopen(tmp, "w");
+	if (!fp)
+		return 1;
+	fprintf(fp, "%d %d\n", status, stage);
+	fflush(record);
+	rewind(record);
+	while ((n = fread(buffer, 1, sizeof(buffer), record)) > 0)
+		fwrite(buffer, 1, n, fp);
+	ok = !ferror(fp) && !ferror(record);
+	if (fclose(fp) != 0)
+		ok = 0;
+
+	if (!ok || rename(tmp, path) != 0)
+	{
+		unlink(tmp);
+		return 1;
+	}
+	return 0;
+}
+
+static int by_mtime(const void *a, const void *b)
+{
+	const CacheEntry *x = a, *y = b;
+
+	return x->mtime < y->mtime ? -1 : x->mtime > y->mtime;
+}
+
+/**
+ * result_cache_prune - Keeps the result cache within RESULT_CACHE_BUDGET_MB.
+ *
+ * Removes least recently used entries down to nine tenths of the budget.
+ * Skipped if another process is pruning already.
+ *
+ * Return: Number of entries removed
+ */
+int result_cache_prune(void)
+{
+	char path[512];
+	CacheEntry *entries = NULL, *grown;
+	struct dirent *de;
+	struct stat st;
+	long total = 0, budget;
+	int fd, i, count = 0, capacity = 0, removed = 0;
+	DIR *dir;
+
+	mkdir(CACHE_DIR, 0755);
+	fd = lock_path(RESULT_CACHE_LOCK, LOCK_EX | LOCK_NB);
+	if (fd < 0)
+		return 0;
+	dir = opendir(RESULT_CACHE);
+	while (dir && (de = readdir(dir)) != NULL)
+	{
+		/* Temporary files of running stores are left alone */
+		if (strlen(de->d_name) != RESULT_KEY_LENGTH - 1)
+			continue;
+		snprintf(path, sizeof(path), "%s/%s", RESULT_CACHE, de->d_name);
+		if (stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+			continue;
+		if (count == capacity)
+		{
+			capacity = capacity ? capacity * 2 : 256;
+			grown = realloc(entries, capacity * sizeof(*grown));
+			if (!grown)
+				break;
+			entries = grown;
+		}
+		strcpy(entries[count].name, de->d_name);
+		entries[count].mtime = (long)st.st_mtime;
+		entries[count].size = (long)st.st_blocks * 512;
+		total += entries[count++].size;
+	}
+	if (dir)
+		closedir(dir);
+
+	budget = (long)RESULT_CACHE_BUDGET_MB * 1024 * 1024;
+	if (total > budget)
+	{
+		qsort(entries, count, sizeof(*entries), by_mtime);
+		for (i = 0; i < count && total > budget - budget / 10; i++)
+		{
+			snprintf(path, sizeof(path), "%s/%s", RESULT_CACHE, entries[i].name);
+			if (unlink(path) == 0)
+			{
+				total -= entries[i].size;
+				removed++;
+			}
+		}
+	}
+	free(entries);
+	unlock_path(fd);
+	return removed;
+}
@@ -0,0 +1,226 @@
+#include "utils.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+#define MAX_GIT_ARGS 64
+
+/* Starts "git [-C dir] args..." with its stdout on @out_fd, stdin on @in_fd if >= 0 */
+static pid_t spawn_git(const char *dir, const char *const args[], int in_fd, int out_fd)
+{
+	const char *argv[MAX_GIT_ARGS];
+	posix_spawn_file_actions_t actions;
+	pid_t pid;
+	int argc = 0, i, ret;
+
+	argv[argc++] = "git";
+	if (dir)
+	{
+		argv[argc++] = "-C";
+		argv[argc++] = dir;
+	}
+	for (i = 0; args[i]; i++)
+	{
+		if (argc == MAX_GIT_ARGS - 1)
+			return -1;
+		argv[argc++] = args[i];
+	}
+	argv[argc] = NULL;
+
+	if (posix_spawn_file_actions_init(&actions) != 0)
+		return -1;
+	if (in_fd >= 0)
+		posix_spawn_file_actions_adddup2(&actions, in_fd, STDIN_FILENO);
+	posix_spawn_file_actions_adddup2(&actions, out_fd, STDOUT_FILENO);
+	fflush(stdout);
+	fflush(stderr);
+	ret = posix_spawnp(&pid, "git", &actions, NULL, (char *const *)argv, environ);
+	posix_spawn_file_actions_destroy(&actions);
+	if (ret != 0)
+	{
+		errno = ret;
+		return -1;
+	}
+	return pid;
+}
+
+static int wait_git(pid_t pid)
+{
+	int status;
+
+	while (waitpid(pid, &status, 0) < 0)
+	{
+		if (errno != EINTR)
+			return -1;
+	}
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/**
+ * run_git - Runs one git command directly, without a shell.
+ * @dir: Repository to operate on (passed as git -C), NULL for the cwd
+ * @args: NULL-terminated arguments that follow "git [-C dir]"
+ *
+ * git is started with posix_spawnp(), so no /bin/sh is involved, arguments
+ * are never re-split or globbed, and the process cwd is never touched; it
+ * is safe to call from several threads or workers at once. git's stdout
+ * goes to stderr so it can never end up in the middle of a report.
+ *
+ * Return: git's exit status, -1 if it could not be run or was killed
+ */
+int run_git(const char *dir, const char *const args[])
+{
+	pid_t pid;
+
+	pid = spawn_git(dir, args, -1, STDERR_FILENO);
+	if (pid < 0)
+		return -1;
+	return wait_git(pid);
+}
+
+/**
+ * run_git_output - Like run_git(), but captures what git prints.
+ * @dir: Repository to operate on, NULL for the cwd
+ * @args: NULL-terminated arguments that follow "git [-C dir]"
+ * @output: Receives stdout, NUL-terminated with trailing newlines removed
+ * @size: Size of @output; longer output is truncated
+ *
+ * Return: git's exit status, -1 if it could not be run or was killed
+ */
+int run_git_output(const char *dir, const char *const args[], char *output, size_t size)
+{
+	return run_git_filter(dir, args, NULL, output, size);
+}
+
+/**
+ * run_git_filter - Like run_git_output(), with stdin read from a file.
+ * @dir: Repository to operate on, NULL for the cwd
+ * @args: NULL-terminated arguments that follow "git [-C dir]"
+ * @input: What git reads, from the start of the file; NULL for none
+ * @output: Receives stdout, NUL-terminated with trailing newlines removed
+ * @size: Size of @output; longer output is truncated
+ *
+ * Return: git's exit status, -1 if it could not be run or was killed
+ */
+int run_git_filter(const char *dir, const char *const args[], FILE *input,
+		char *output, size_t size)
+{
+	size_t len = 0;
+	ssize_t n;
+	char discard[256];
+	int fds[2];
+	pid_t pid;
+
+	if (size == 0 || pipe(fds) != 0)
+		return -1;
+	if (input)
+	{
+		fflush(input);
+		lseek(fileno(input), 0, SEEK_SET);
+	}
+	pid = spawn_git(dir, args, input ? fileno(input) : -1, fds[1]);
+	close(fds[1]);
+	if (pid < 0)
+	{
+		close(fds[0]);
+		return -1;
+	}
+
+	for (;;)
+	{
+		if (len < size - 1)
+			n = read(fds[0], output + len, size - 1 - len);
+		else
+			n = read(fds[0], discard, sizeof(discard));
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		if (len < size - 1)
+			len += n;
+	}
+	close(fds[0]);
+
+	while (len > 0 && output[len - 1] == '\n')
+		len--;
+	output[len] = '\0';
+	return wait_git(pid);
+}
+
+/**
+ * run_git_read - Like run_git_filter(), for output of any length.
+ * @dir: Repository to operate on, NULL for the cwd
+ * @args: NULL-terminated arguments that follow "git [-C dir]"
+ * @input: What git reads, from the start of the file; NULL for none
+ * @output: Receives a malloc()ed, NUL-terminated copy of stdout, or NULL
+ *
+ * Return: git's exit status, -1 if it could not be run, was killed or the
+ * output did not fit in memory
+ */
+int run_git_read(const char *dir, const char *const args[], FILE *input, char **output)
+{
+	size_t len = 0, size = 4096;
+	char *buf, *grown;
+	ssize_t n;
+	int fds[2], ret, ok = 1;
+	pid_t pid;
+
+	*output = NULL;
+	buf = malloc(size);
+	if (!buf || pipe(fds) != 0)
+	{
+		free(buf);
+		return -1;
+	}
+	if (input)
+	{
+		fflush(input);
+		lseek(fileno(input), 0, SEEK_SET);
+	}
+	pid = spawn_git(dir, args, input ? fileno(input) : -1, fds[1]);
+	close(fds[1]);
+	if (pid < 0)
+	{
+		close(fds[0]);
+		free(buf);
+		return -1;
+	}
+
+	for (;;)
+	{
+		if (ok && len == size - 1)
+		{
+			grown = realloc(buf, size * 2);
+			if (grown)
+			{
+				buf = grown;
+				size *= 2;
+			}
+			else
+				ok = 0;
+		}
+		/* After a failed realloc() the rest is drained so git can exit */
+		n = ok ? read(fds[0], buf + len, size - 1 - len) : read(fds[0], buf, size - 1);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		if (ok)
+			len += n;
+	}
+	close(fds[0]);
+
+	buf[len] = '\0';
+	ret = wait_git(pid);
+	if (!ok)
+	{
+		free(buf);
+		return -1;
+	}
+	*output = buf;
+	return ret;
+}
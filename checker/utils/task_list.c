@@ -0,0 +1,49 @@
+#include "utils.h"
+
+/**
+ * task_list_init - Creates an empty task list with its own arena.
+ * @list: List to initialise; release with task_list_free()
+ *
+ * Return: 0 on success, 1 on allocation failure
+ */
+int task_list_init(TaskList *list)
+{
+	memset(list, 0, sizeof(*list));
+	list->arena = arena_create();
+	return list->arena ? 0 : 1;
+}
+
+/**
+ * task_list_add - Appends a zeroed task.
+ * @list: List to grow
+ *
+ * Return: The new task, valid until the next task_list_add(), NULL on
+ * allocation failure
+ */
+Task *task_list_add(TaskList *list)
+{
+	Task *grown;
+	int capacity;
+
+	if (list->count == list->capacity)
+	{
+		capacity = list->capacity ? list->capacity * 2 : 16;
+		grown = arena_grow(list->arena, list->items, sizeof(Task) * list->capacity,
+				sizeof(Task) * capacity);
+		if (!grown)
+			return NULL;
+		list->items = grown;
+		list->capacity = capacity;
+	}
+	return &list->items[list->count++];
+}
+
+/**
+ * task_list_free - Releases a task list, its tasks and all their strings.
+ * @list: List from task_list_init()
+ */
+void task_list_free(TaskList *list)
+{
+	arena_destroy(list->arena);
+	memset(list, 0, sizeof(*list));
+}
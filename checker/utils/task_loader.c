@@ -1,4 +1,6 @@
 #include "utils.h"
+#include "../reporter/reporter.h"
+#include "../trace/trace.h"
 #include <json-c/json.h>
 #include <dirent.h>
 #include <sys/types.h>
@@ -7,11 +9,6 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include "../typewriter/typewriter.h"
-
-/* External global task names and count declared in main */
-char **g_task_names;
-int g_task_name_count;
 
 int is_directory(const char *path)
 {
@@ -19,18 +16,17 @@ int is_directory(const char *path)
 	return (stat(path, &st) == 0 && S_ISDIR(st.st_mode));
 }
 
-int load_tasks_from_directory(const char *json_dir, const char *repo_dir, Task *tasks, int *task_count)
+int load_tasks_from_directory(const char *json_dir, const char *repo_dir, TaskList *tasks)
 {
 	DIR *dir;
 	struct dirent *entry;
 	char path[1024];
 	int result;
-	int prev_count;
 
 	dir = opendir(json_dir);
 	if (!dir)
 	{
-		perror("Could not open JSON tasks directory");
+		report_perror("Could not open JSON tasks directory");
 		return 1;
 	}
 
@@ -43,74 +39,72 @@ int load_tasks_from_directory(const char *json_dir, const char *repo_dir, Task *
 
 		if (entry->d_type == DT_DIR)
 		{
-			result = load_tasks_from_directory(path, repo_dir, tasks, task_count);
-			if (result == 0)
-			{
-				closedir(dir);
-				return 0;
-			}
+			load_tasks_from_directory(path, repo_dir, tasks);
 		}
 		else if (entry->d_type == DT_REG && strstr(entry->d_name, ".json") != NULL)
 		{
-			prev_count = *task_count;
-			result = load_tasks(path, repo_dir, tasks, task_count);
+			result = load_tasks(path, repo_dir, tasks);
 
 			if (result != 0)
-			{
-				fprintf(stderr, "Failed to load %s\n", path);
-				continue;
-			}
-
-			if (*task_count > prev_count)
-			{
-				closedir(dir);
-				return 0;
-			}
+				report_error("Failed to load %s\n", path);
 		}
 	}
 
 	closedir(dir);
-	return 1;
+	return tasks->count > 0 ? 0 : 1;
 }
 
-int load_tasks(const char *json_source, const char *repo_dir, Task *tasks, int *task_count)
+/**
+ * load_tasks - Appends the tasks of a JSON catalog to a list.
+ * @json_source: Catalog file, or directory searched for *.json files
+ * @repo_dir: Prefix for each task's path, NULL to keep paths relative
+ * @tasks: Initialised list; strings are interned in its arena
+ *
+ * Return: 0 on success, 1 otherwise
+ */
+int load_tasks(const char *json_source, const char *repo_dir, TaskList *tasks)
 {
 	FILE *fp;
 	long length;
 	char *data;
 	struct json_object *parsed;
-	int i, j;
+	int i;
 	int count;
-	int loaded_count;
+	Task *task;
+	Arena *arena = tasks->arena;
 	struct json_object *obj;
 	struct json_object *name_obj;
 	struct json_object *path_obj;
 	struct json_object *main_obj;
 	struct json_object *target_obj;
 	struct json_object *expected_obj;
+	struct json_object *rules_obj;
+	struct json_object *required_obj;
+	const char *rules;
+	const char *file;
 	const char *name;
 	char full_path[512];
 	const char *path;
 	const char *main;
 	const char *target;
 	const char *expected;
-	char msg[512];
-	int match;
+	int required;
+	int f;
 
 	if (is_directory(json_source))
 	{
-		return load_tasks_from_directory(json_source, repo_dir, tasks, task_count);
+		return load_tasks_from_directory(json_source, repo_dir, tasks);
 	}
 	fp = fopen(json_source, "r");
 	if (!fp)
 	{
-		fprintf(stderr, "Could not open JSON file: %s\n", json_source);
+		report_error("Could not open JSON file: %s\n", json_source);
 		return 1;
 	}
 
 	if (fseek(fp, 0, SEEK_END) != 0)
 	{
-		fprintf(stderr, "Failed to seek JSON file.\n");
+		report_error("Failed to seek JSON file.\n");
 		fclose(fp);
 		return 1;
 	}
@@ -118,7 +112,7 @@ int load_tasks(const char *json_source, const char *repo_dir, Task *tasks, int *
 	length = ftell(fp);
 	if (length < 0)
 	{
-		fprintf(stderr, "Failed to get file length.\n");
+		report_error("Failed to get file length.\n");
 		fclose(fp);
 		return 1;
 	}
@@ -128,14 +122,14 @@ int load_tasks(const char *json_source, const char *repo_dir, Task *tasks, int *
 	data = malloc(length + 1);
 	if (!data)
 	{
-		fprintf(stderr, "Memory allocation failed.\n");
+		report_error("Memory allocation failed.\n");
 		fclose(fp);
 		return 1;
 	}
 
 	if (fread(data, 1, length, fp) != (size_t)length)
 	{
-		fprintf(stderr, "Failed to read JSON file.\n");
+		report_error("Failed to read JSON file.\n");
 		free(data);
 		fclose(fp);
 		return 1;
@@ -143,22 +137,18 @@ int load_tasks(const char *json_source, const char *repo_dir, Task *tasks, int *
 	data[length] = '\0';
 	fclose(fp);
 
+	TRACE_BEGIN("parse_catalog", json_source);
 	parsed = json_tokener_parse(data);
+	TRACE_END("parse_catalog");
 	if (!parsed || !json_object_is_type(parsed, json_type_array))
 	{
-		fprintf(stderr, "Invalid JSON format.\n");
+		report_error("Invalid JSON format.\n");
 		free(data);
 		return 1;
 	}
 
+	/* Appended after tasks loaded from earlier catalog files */
 	count = json_object_array_length(parsed);
-	if (count > MAX_TASKS)
-	{
-		fprintf(stderr, "Warning: Only processing first %d of %d tasks.\n", MAX_TASKS, count);
-		count = MAX_TASKS;
-	}
-
-	loaded_count = 0;
 	for (i = 0; i < count; i++)
 	{
 		obj = json_object_array_get_idx(parsed, i);
@@ -168,7 +158,7 @@ int load_tasks(const char *json_source, const char *repo_dir, Task *tasks, int *
 				!json_object_object_get_ex(obj, "target", &target_obj) ||
 				!json_object_object_get_ex(obj, "expected_output", &expected_obj))
 		{
-			fprintf(stderr, "Missing field(s) in task %d\n", i);
+			report_error("Missing field(s) in task %d\n", i);
 			continue;
 		}
 
@@ -180,46 +170,76 @@ int load_tasks(const char *json_source, const char *repo_dir, Task *tasks, int *
 
 		if (!name || !path || !main || !target || !expected)
 		{
-			fprintf(stderr, "Null value in string field(s) of task %d\n", i);
+			report_error("Null value in string field(s) of task %d\n", i);
 			continue;
 		}
 
-		match = 0;
-		for (j = 0; j < g_task_name_count; j++)
+		/* Kept as JSON text; the validators compile it (validators/rules/) */
+		rules = NULL;
+		required_obj = NULL;
+		if (json_object_object_get_ex(obj, "rules", &rules_obj))
 		{
-			if (strcmp(name, g_task_names[j]) == 0)
+			if (!json_object_is_type(rules_obj, json_type_object) ||
+					(json_object_object_get_ex(rules_obj, "required_files", &required_obj) &&
+					 !json_object_is_type(required_obj, json_type_array)))
 			{
-				match = 1;
-				break;
+				report_error("Invalid rules in task %s\n", name);
+				continue;
 			}
+			rules = json_object_to_json_string_ext(rules_obj, JSON_C_TO_STRING_PLAIN);
+		}
+		required = required_obj ? (int)json_object_array_length(required_obj) : 0;
+
+		if (repo_dir)
+			snprintf(full_path, sizeof(full_path), "%s/%s", repo_dir, path);
+		else
+			snprintf(full_path, sizeof(full_path), "%s", path);
+
+		task = task_list_add(tasks);
+		if (!task)
+			break;
+		task->task_name = arena_intern(arena, name);
+		task->expected_path = arena_intern(arena, full_path);
+		task->main_file = arena_intern(arena, main);
+		task->target_file = arena_intern(arena, target);
+		task->expected_output = arena_intern(arena, expected);
+		task->rules = arena_intern(arena, rules);
+
+		task->expected_files = arena_alloc(arena, sizeof(*task->expected_files) * (2 + required));
+		if (!task->task_name || !task->expected_path || !task->main_file ||
+				!task->target_file || !task->expected_output ||
+				(rules && !task->rules) || !task->expected_files)
+		{
+			/* Drop the half-filled task */
+			tasks->count--;
+			break;
+		}
+		task->expected_files[0] = task->main_file;
+		task->expected_files[1] = task->target_file;
+		task->file_count = 2;
+		for (f = 0; f < required; f++)
+		{
+			file = json_object_get_string(json_object_array_get_idx(required_obj, f));
+			if (!file || !*file)
+				continue;
+			file = arena_intern(arena, file);
+			if (!file)
+				break;
+			task->expected_files[task->file_count++] = file;
+		}
+		if (f < required)
+		{
+			tasks->count--;
+			break;
 		}
-
-		if (!match)
-			continue;
-		snprintf(full_path, sizeof(full_path), "%s/%s", repo_dir, path);
-
-
-		tasks[loaded_count].task_name = strdup(name);
-		tasks[loaded_count].expected_path = strdup(full_path);
-		tasks[loaded_count].main_file = strdup(main);
-		tasks[loaded_count].target_file = strdup(target);
-		tasks[loaded_count].expected_output = strdup(expected);
-
-		tasks[loaded_count].expected_files[0] = strdup(tasks[loaded_count].main_file);
-		tasks[loaded_count].expected_files[1] = strdup(tasks[loaded_count].target_file);
-		tasks[loaded_count].file_count = 2;
-
-		snprintf(msg, sizeof(msg), "Loaded Task %d: name=%s path=%s target=%s\n",
-				loaded_count + 1, tasks[loaded_count].task_name,
-				tasks[loaded_count].expected_path,
-				tasks[loaded_count].target_file);
-		typewrite(20000, "%s", msg);
-
-		loaded_count++;
 	}
 
-	*task_count = loaded_count;
 	free(data);
 	json_object_put(parsed);
+	if (i < count)
+	{
+		report_error("Memory allocation failed.\n");
+		return 1;
+	}
 	return 0;
 }
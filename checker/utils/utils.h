@@ -1,23 +1,87 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
 #include "../main/checker.h"
 
-extern char **g_task_names;
-extern int g_task_name_count;
+#define RESULT_KEY_LENGTH 65
+
+/* A submission file shared by every check of a run, see file_cache.c */
+typedef struct CachedFile {
+	const char *path;
+	const char *data;     /* read-only mapping, NULL until loaded or if empty */
+	size_t size;
+	struct timespec mtime;
+	dev_t dev;
+	ino_t ino;
+	int is_dir;
+	int loaded;
+	char hash[65];        /* SHA-256 hex, empty until first use */
+	struct CachedFile *next;
+} CachedFile;
+
+/* The remote default branch and its head, as one ls-remote reported them */
+typedef struct {
+	char branch[256];
+	char sha[128];        /* empty until probed */
+} RemoteHead;
+
+extern int result_cache_enabled;
 
 char *get_directory_path(const char *filepath, char *output, size_t size);
 int check_task_files(Task *task);
-void free_tasks(Task *tasks, int count);
+Arena *arena_create(void);
+void *arena_alloc(Arena *arena, size_t size);
+void *arena_grow(Arena *arena, void *old, size_t old_size, size_t new_size);
+char *arena_strdup(Arena *arena, const char *str);
+const char *arena_intern(Arena *arena, const char *str);
+void arena_destroy(Arena *arena);
+HashMap *map_create(size_t value_size, Arena *keys);
+void *map_get(const HashMap *map, const char *key);
+void *map_put(HashMap *map, const char *key, const char **stored_key);
+int map_add(HashMap *set, const char *key);
+size_t map_count(const HashMap *map);
+void map_free(HashMap *map);
+uint32_t map_hash(const char *key);
+int task_list_init(TaskList *list);
+Task *task_list_add(TaskList *list);
+void task_list_free(TaskList *list);
 int is_valid_git_url(const char *url);
 int check_output(const char *script_path, const char *expected_string);
 void trim_trailing_whitespace(char *str);
-int clone_repo(const char *url, const char *target_dir);
+int run_git(const char *dir, const char *const args[]);
+int run_git_output(const char *dir, const char *const args[], char *output, size_t size);
+int run_git_filter(const char *dir, const char *const args[], FILE *input,
+		char *output, size_t size);
+int run_git_read(const char *dir, const char *const args[], FILE *input, char **output);
+int clone_repo(const char *url, const char *target_dir, const char *username,
+		const char **paths, int path_count);
 char *extract_username(const char *url);
 int rename_repo(const char *old, const char *new_path);
-int update_repo(const char *dir);
-int load_tasks(const char *json_source, const char *repo_dir, Task *tasks, int *task_count);
-int load_tasks_from_directory(const char *json_dir, const char *repo_dir, Task *tasks, int *task_count);
+int update_repo(const char *dir, const char **paths, int path_count, RemoteHead *remote);
+int load_tasks(const char *json_source, const char *repo_dir, TaskList *tasks);
+int load_tasks_from_directory(const char *json_dir, const char *repo_dir, TaskList *tasks);
 int is_directory(const char *path);
+int lock_path(const char *path, int operation);
+void unlock_path(int fd);
+int repo_lock(const char *repo_dir, int operation);
+int repo_is_current(const char *dir, const char **paths, int path_count, RemoteHead *remote);
+int remove_tree(const char *path);
+int store_lock(int operation);
+void store_unlock(int fd);
+int store_share(const char *repo_dir, const char *url, const char *username,
+		const char **paths, int path_count);
+int store_forget(const char *username);
+int store_gc(void);
+int result_cache_key(const Task *task, char *key);
+FILE *result_cache_open(const char *key, int *status, int *stage);
+int result_cache_store(const char *key, FILE *record, int status, int stage);
+int result_cache_prune(void);
+CachedFile *file_cache_stat(const char *path);
+CachedFile *file_cache_load(const char *path);
+const char *file_cache_hash(CachedFile *file);
+void file_cache_clear(void);
 
 #endif
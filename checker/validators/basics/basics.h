@@ -1,7 +0,0 @@
-#ifndef BASICS_H
-#define BASICS_H
-
-int validate_recursion_file(const char *filepath);
-int validate_factorial_file(const char *filepath);
-
-#endif
@@ -0,0 +1,238 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include "registry_hash.h"
+#include "../plugin_api.h"
+#include "../rules/rules.h"
+#include "../../utils/utils.h"
+#include "../../reporter/reporter.h"
+
+/*
+ * Validator plugins: every *.so in the plugin directory is dlopen()ed and
+ * its CheckerPlugin table merged into one name -> validator map, which
+ * get_validator() consults before a task's catalog rules. plugins_rescan() reloads
+ * the whole set when the directory's listing, sizes or mtimes change, so
+ * a long-running daemon picks up new or replaced plugins between jobs.
+ * Replace a plugin by writing a new file and renaming it over the old one.
+ */
+
+typedef struct {
+	void **handles;
+	int count;
+	int capacity;
+	HashMap *validators; /* task name -> ValidatorFn */
+	char dir[512];
+	uint32_t signature;  /* of the listing the set was loaded from */
+} PluginSet;
+
+static PluginSet plugins;
+
+static const char *host_read_file(const char *filepath, size_t *size)
+{
+	CachedFile *file;
+
+	file = file_cache_load(filepath);
+	if (!file || file->is_dir)
+		return NULL;
+	*size = file->size;
+	/* An empty file has no mapping */
+	return file->data ? file->data : "";
+}
+
+static const CheckerHost host = {
+	CHECKER_PLUGIN_ABI,
+	report_info,
+	report_error,
+	report_progress,
+	rules_check,
+	host_read_file
+};
+
+static int is_plugin(const char *name)
+{
+	size_t len = strlen(name);
+
+	return name[0] != '.' && len > 3 && strcmp(name + len - 3, ".so") == 0;
+}
+
+/* Hash of every plugin's name, size and mtime, 0 if the directory is missing */
+static uint32_t dir_signature(const char *dir)
+{
+	struct dirent *entry;
+	struct stat st;
+	char path[1024], line[1200];
+	uint32_t signature = 1;
+	DIR *d;
+
+	d = opendir(dir);
+	if (!d)
+		return 0;
+	while ((entry = readdir(d)) != NULL)
+	{
+		if (!is_plugin(entry->d_name))
+			continue;
+		snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+		if (stat(path, &st) != 0)
+			continue;
+		snprintf(line, sizeof(line), "%s:%ld:%ld.%09ld:%lu", entry->d_name, (long)st.st_size,
+				(long)st.st_mtim.tv_sec, st.st_mtim.tv_nsec, (unsigned long)st.st_ino);
+		/* Order independent, readdir() order is not stable */
+		signature += map_hash(line);
+	}
+	closedir(d);
+	return signature;
+}
+
+static void unload_all(void)
+{
+	int i;
+
+	map_free(plugins.validators);
+	plugins.validators = NULL;
+	for (i = 0; i < plugins.count; i++)
+		dlclose(plugins.handles[i]);
+	free(plugins.handles);
+	plugins.handles = NULL;
+	plugins.count = plugins.capacity = 0;
+}
+
+static int keep_handle(void *handle)
+{
+	void **grown;
+
+	if (plugins.count == plugins.capacity)
+	{
+		plugins.capacity = plugins.capacity ? plugins.capacity * 2 : 8;
+		grown = realloc(plugins.handles, sizeof(*grown) * plugins.capacity);
+		if (!grown)
+			return 1;
+		plugins.handles = grown;
+	}
+	plugins.handles[plugins.count++] = handle;
+	return 0;
+}
+
+static void load_plugin(const char *path)
+{
+	const CheckerPluginValidator *v;
+	const CheckerPlugin *plugin;
+	ValidatorFn *slot;
+	void *handle;
+	int added = 0;
+
+	handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+	if (!handle)
+	{
+		report_error("Warning: could not load plugin %s: %s\n", path, dlerror());
+		return;
+	}
+	plugin = dlsym(handle, CHECKER_PLUGIN_SYMBOL);
+	if (!plugin || plugin->abi_version != CHECKER_PLUGIN_ABI || !plugin->validators)
+	{
+		report_error("Warning: %s is not a checker plugin for ABI %d\n", path, CHECKER_PLUGIN_ABI);
+		dlclose(handle);
+		return;
+	}
+	if ((plugin->init && plugin->init(&host) != 0) || keep_handle(handle) != 0)
+	{
+		report_error("Warning: plugin %s failed to initialise\n", path);
+		dlclose(handle);
+		return;
+	}
+
+	for (v = plugin->validators; v->task_name; v++)
+	{
+		if (!v->validate)
+			continue;
+		if (map_get(plugins.validators, v->task_name))
+			report_info("Plugin %s overrides the validator for %s\n", plugin->name, v->task_name);
+		slot = map_put(plugins.validators, v->task_name, NULL);
+		if (slot)
+		{
+			*slot = v->validate;
+			added++;
+		}
+	}
+	report_info("Loaded plugin %s (%d validators)\n", plugin->name ? plugin->name : path, added);
+}
+
+/**
+ * plugins_load - Loads every plugin in a directory, replacing any loaded set.
+ * @dir: Plugin directory; a missing one just means no plugins
+ *
+ * Return: 0 on success, 1 on allocation failure
+ */
+int plugins_load(const char *dir)
+{
+	struct dirent *entry;
+	char path[1024];
+	DIR *d;
+
+	unload_all();
+	/* plugins_rescan() passes our own copy back in */
+	if (dir != plugins.dir)
+		snprintf(plugins.dir, sizeof(plugins.dir), "%s", dir);
+	dir = plugins.dir;
+	plugins.signature = dir_signature(dir);
+	plugins.validators = map_create(sizeof(ValidatorFn), NULL);
+	if (!plugins.validators)
+		return 1;
+
+	d = opendir(dir);
+	if (!d)
+		return 0;
+	while ((entry = readdir(d)) != NULL)
+	{
+		if (!is_plugin(entry->d_name))
+			continue;
+		/* dlopen() only searches the library path for names without a slash */
+		snprintf(path, sizeof(path), "%s%s/%s", dir[0] == '/' ? "" : "./", dir, entry->d_name);
+		load_plugin(path);
+	}
+	closedir(d);
+	return 0;
+}
+
+/**
+ * plugins_rescan - Reloads the plugin set if the directory changed.
+ *
+ * Return: 1 if plugins were reloaded, 0 otherwise
+ */
+int plugins_rescan(void)
+{
+	if (!plugins.dir[0] || dir_signature(plugins.dir) == plugins.signature)
+		return 0;
+	report_info("Plugin directory %s changed, reloading\n", plugins.dir);
+	plugins_load(plugins.dir);
+	return 1;
+}
+
+/**
+ * plugins_signature - Identifies the loaded plugin set.
+ *
+ * Return: Hash of the plugin files' names, sizes and mtimes, 0 if there is
+ * no plugin directory
+ */
+uint32_t plugins_signature(void)
+{
+	return plugins.signature;
+}
+
+/**
+ * plugin_validator - Looks up a validator provided by a plugin.
+ * @task_name: Task to validate
+ *
+ * Return: The plugin's validator, NULL if no plugin provides one
+ */
+ValidatorFn plugin_validator(const char *task_name)
+{
+	ValidatorFn *slot;
+
+	if (!plugins.validators)
+		return NULL;
+	slot = map_get(plugins.validators, task_name);
+	return slot ? *slot : NULL;
+}
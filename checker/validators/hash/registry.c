@@ -1,28 +1,29 @@
-#include <stdlib.h>
-#include <string.h>
 #include "registry_hash.h"
-#include "hash.h"
-#include "../validators/basics/basics.h"
+#include "../../reporter/reporter.h"
 
-static HashTable *validator_table = NULL;
+/*
+ * Task checks are declared as rules in the catalog (see validators/rules/)
+ * and need no C code; the registry only holds validators from plugins,
+ * which replace a task's rules when its checks cannot be expressed there.
+ */
 
-extern int validate_recursion_file(const char *);
-extern int validate_factorial_file(const char *);
-
-void init_registry(void)
+/**
+ * init_registry - Loads validator plugins.
+ * @plugin_dir: Directory searched for *.so plugins
+ */
+void init_registry(const char *plugin_dir)
 {
-	validator_table = create_table(1024);
-	if (!validator_table)
-		return;
-
-	insert(validator_table, "recursion", validate_recursion_file);
-	insert(validator_table, "factorial", validate_factorial_file);
+	if (plugins_load(plugin_dir) != 0)
+		report_error("Warning: validator plugins are disabled.\n");
 }
 
+/**
+ * get_validator - Finds the plugin validator for a task.
+ * @task_name: Task to validate
+ *
+ * Return: The validator, NULL if the task's catalog rules apply
+ */
 ValidatorFn get_validator(const char *task_name)
 {
-	if (!validator_table)
-		return NULL;
-
-	return get(validator_table, task_name);
+	return plugin_validator(task_name);
 }
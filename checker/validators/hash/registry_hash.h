@@ -1,11 +1,17 @@
 #ifndef REGISTRY_HASH_H
 #define REGISTRY_HASH_H
 
-#include "../validators.h"
+#include <stdint.h>
 
 typedef int (*ValidatorFn)(const char *filepath);
 
-void init_registry(void);
+#include "../validators.h"
+
+void init_registry(const char *plugin_dir);
 ValidatorFn get_validator(const char *task_name);
+int plugins_load(const char *dir);
+int plugins_rescan(void);
+uint32_t plugins_signature(void);
+ValidatorFn plugin_validator(const char *task_name);
 
 #endif
@@ -1,30 +1,27 @@
 #include "linters.h"
+#include "../../reporter/reporter.h"
+#include "../../utils/utils.h"
 #include <stdio.h>
 
 int check_readme(const char *path)
 {
-	FILE *f = NULL;
+	CachedFile *readme;
 	char fullpath[1024];
-	long size = 0;
 
 	snprintf(fullpath, sizeof(fullpath), "%s/README.md", path);
 
-	f = fopen(fullpath, "r");
-	if (!f) {
-		fprintf(stderr, "Missing README.md in %s\n", path);
+	readme = file_cache_stat(fullpath);
+	if (!readme || readme->is_dir) {
+		report_error("Missing README.md in %s\n", path);
 		return 0;
 	}
 
-	fseek(f, 0, SEEK_END);
-	size = ftell(f);
-	fclose(f);
-
-	if (size <= 0) {
-		fprintf(stderr, "README.md is empty in %s\n", path);
+	if (readme->size == 0) {
+		report_error("README.md is empty in %s\n", path);
 		return 0;
 	}
 
-	printf("README.md found and is not empty in %s\n", fullpath);
+	report_info("README.md found and is not empty in %s\n", fullpath);
 	return 1;
 }
 
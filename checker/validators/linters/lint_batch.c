@@ -0,0 +1,355 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "linters.h"
+#include "../../utils/utils.h"
+#include "../../reporter/reporter.h"
+#include "../../trace/trace.h"
+
+/*
+ * Lint results prepared for a whole job. run_job() hands every target it is
+ * about to check to lint_prepare(), which takes what it can from the lint
+ * cache, lints the rest of the Python files with one request to the
+ * pycodestyle worker (or one pycodestyle command) and the rest of the C
+ * files with one betty command, then files each message under its path.
+ * run_pycodestyle() and run_betty_linter() replay a prepared file instead of
+ * linting it again, so every task still passes or fails on its own; a file
+ * that was not prepared is linted by itself as before.
+ */
+
+typedef struct {
+	const char *label;  /* "Pycodestyle" or "Betty" */
+	const char **lines; /* messages after the "path:" the linter prints */
+	int count;
+	int capacity;
+	int queued;         /* already part of a batch */
+	int ready;          /* linted, lines are complete */
+} LintRecord;
+
+static Arena *lint_arena;
+static HashMap *prepared; /* path -> LintRecord */
+
+static int add_line(LintRecord *record, const char *line)
+{
+	const char **lines;
+	int capacity;
+
+	if (record->count == record->capacity)
+	{
+		capacity = record->capacity ? record->capacity * 2 : 8;
+		lines = arena_grow(lint_arena, (void *)record->lines,
+				sizeof(*lines) * record->capacity, sizeof(*lines) * capacity);
+		if (!lines)
+			return 1;
+		record->lines = lines;
+		record->capacity = capacity;
+	}
+	record->lines[record->count] = arena_strdup(lint_arena, line);
+	if (!record->lines[record->count])
+		return 1;
+	record->count++;
+	return 0;
+}
+
+/* Files @count records under their paths once the whole batch succeeded */
+static void publish(const char **paths, LintRecord *records, int count)
+{
+	LintRecord *slot;
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		slot = map_get(prepared, paths[i]);
+		if (slot)
+		{
+			*slot = records[i];
+			slot->queued = slot->ready = 1;
+		}
+	}
+}
+
+/* The pycodestyle worker answers per file, no splitting needed */
+static int prepare_with_worker(const char **paths, int count, LintRecord *records)
+{
+	const LintDiagnostic *d;
+	LintResult *results;
+	char line[2048];
+	int i, j;
+
+	results = arena_alloc(lint_arena, sizeof(*results) * count);
+	if (!results || lint_worker_lint(paths, count, lint_arena, results) != 0)
+		return 1;
+	for (i = 0; i < count; i++)
+	{
+		for (j = 0; j < results[i].count; j++)
+		{
+			d = &results[i].diagnostics[j];
+			snprintf(line, sizeof(line), "%d:%d: %s\n", d->line, d->column, d->text);
+			if (add_line(&records[i], line) != 0)
+				return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * lint_is_banner - Tells whether a line of linter output is just layout.
+ * @line: Line as the linter printed it
+ *
+ * betty opens each file's section with "========== <file> ==========",
+ * preceded by a blank line; neither says anything about the file.
+ *
+ * Return: 1 for blank and banner lines, 0 otherwise
+ */
+int lint_is_banner(const char *line)
+{
+	return line[strspn(line, " \t\r\n")] == '\0' || strncmp(line, "==========", 10) == 0;
+}
+
+/* Index of the path a betty banner names, -1 if it names none of @paths */
+static int banner_owner(const char *line, const char **paths, int count)
+{
+	size_t len;
+	int i;
+
+	line += strspn(line, "= ");
+	for (i = 0; i < count; i++)
+	{
+		len = strlen(paths[i]);
+		if (strncmp(line, paths[i], len) == 0 && strncmp(line + len, " =", 2) == 0)
+			return i;
+	}
+	return -1;
+}
+
+/*
+ * Runs "@command path..." once and gives each output line to the path it
+ * starts with. Lines without a path, such as checkpatch's summary, belong to
+ * the file the last banner or message named. A line that can not be
+ * attributed (a crash, a missing command) drops the batch, and each file is
+ * linted alone.
+ */
+static int prepare_with_command(const char *command,
+		const char **paths, int count, LintRecord *records)
+{
+	char buffer[1024];
+	const char *text;
+	size_t size, len;
+	char *cmd;
+	FILE *fp;
+	int i, owner, current = -1, ok = 1;
+
+	size = strlen(command) + 1;
+	for (i = 0; i < count; i++)
+		size += strlen(paths[i]) + 1;
+	cmd = arena_alloc(lint_arena, size);
+	if (!cmd)
+		return 1;
+	strcpy(cmd, command);
+	for (i = 0; i < count; i++)
+	{
+		strcat(cmd, " ");
+		strcat(cmd, paths[i]);
+	}
+
+	fp = popen(cmd, "r");
+	if (!fp)
+		return 1;
+	while (fgets(buffer, sizeof(buffer), fp))
+	{
+		/* After a failure the output is only drained */
+		if (!ok)
+			continue;
+		if (lint_is_banner(buffer))
+		{
+			owner = banner_owner(buffer, paths, count);
+			if (owner >= 0)
+				current = owner;
+			continue;
+		}
+		owner = -1;
+		text = buffer;
+		for (i = 0; owner < 0 && i < count; i++)
+		{
+			len = strlen(paths[i]);
+			if (strncmp(buffer, paths[i], len) == 0 && buffer[len] == ':')
+			{
+				owner = current = i;
+				text = buffer + len + 1;
+			}
+		}
+		if (owner < 0)
+			owner = current;
+		if (owner < 0 || add_line(&records[owner], text) != 0)
+			ok = 0;
+	}
+	pclose(fp);
+	return ok ? 0 : 1;
+}
+
+static void reset_records(LintRecord *records, int count, const char *label)
+{
+	int i;
+
+	memset(records, 0, sizeof(*records) * count);
+	for (i = 0; i < count; i++)
+		records[i].label = label;
+}
+
+/* Fills @record from the lint cache, 1 on a miss */
+static int load_cached(const char *key, LintRecord *record)
+{
+	char buffer[2048];
+	FILE *fp;
+	int ok = 1;
+
+	fp = lint_cache_open(key);
+	if (!fp)
+		return 1;
+	while (ok && fgets(buffer, sizeof(buffer), fp))
+		ok = add_line(record, buffer) == 0;
+	fclose(fp);
+	return ok ? 0 : 1;
+}
+
+/* Caches a fresh result unless a message names the file, which would not fit other copies */
+static int store_cached(const char *key, const char *path, const LintRecord *record)
+{
+	int i;
+
+	for (i = 0; i < record->count; i++)
+	{
+		if (strstr(record->lines[i], path))
+			return 1;
+	}
+	return lint_cache_store(key, record->lines, record->count);
+}
+
+/* Returns how many fresh results were added to the lint cache */
+static int prepare_group(const char **paths, int count, int python)
+{
+	const char *linter = python ? "pycodestyle" : "betty";
+	const char *label = python ? "Pycodestyle" : "Betty";
+	char (*keys)[LINT_KEY_LENGTH];
+	const char **misses;
+	LintRecord *records;
+	int i, ret = 1, miss_count = 0, stored = 0;
+
+	if (count == 0)
+		return 0;
+	keys = arena_alloc(lint_arena, sizeof(*keys) * count);
+	misses = arena_alloc(lint_arena, sizeof(*misses) * count);
+	records = arena_alloc(lint_arena, sizeof(*records) * count);
+	if (!keys || !misses || !records)
+		return 0;
+	reset_records(records, count, label);
+	for (i = 0; i < count; i++)
+	{
+		if (lint_cache_key(linter, paths[i], keys[miss_count]) != 0)
+			keys[miss_count][0] = '\0';
+		else if (load_cached(keys[miss_count], &records[i]) == 0)
+		{
+			publish(&paths[i], &records[i], 1);
+			continue;
+		}
+		misses[miss_count++] = paths[i];
+	}
+	if (miss_count == 0)
+		return 0;
+
+	reset_records(records, miss_count, label);
+	if (python)
+	{
+		TRACE_BEGIN("lint_worker", misses[0]);
+		ret = prepare_with_worker(misses, miss_count, records);
+		TRACE_END("lint_worker");
+	}
+	if (!python || ret != 0)
+	{
+		/* Traced under the linter's name, so a fallback shows up as such */
+		reset_records(records, miss_count, label);
+		TRACE_BEGIN(linter, misses[0]);
+		ret = prepare_with_command(linter, misses, miss_count, records);
+		TRACE_END(linter);
+		if (ret != 0)
+			return 0;
+	}
+	publish(misses, records, miss_count);
+	for (i = 0; i < miss_count; i++)
+	{
+		if (keys[i][0] && store_cached(keys[i], misses[i], &records[i]) == 0)
+			stored++;
+	}
+	return stored;
+}
+
+/**
+ * lint_prepare - Lints every target of a job in one run per linter.
+ * @paths: Files the job's tasks will lint; duplicates are allowed
+ * @count: Number of paths
+ *
+ * Files that cannot be linted as part of the batch are simply left out and
+ * are linted one by one when their task gets to them.
+ */
+void lint_prepare(const char **paths, int count)
+{
+	const char **python, **other;
+	LintRecord *record;
+	int i, python_count = 0, other_count = 0;
+
+	if (!prepared)
+	{
+		lint_arena = arena_create();
+		prepared = lint_arena ? map_create(sizeof(LintRecord), lint_arena) : NULL;
+		if (!prepared)
+			return;
+	}
+	python = arena_alloc(lint_arena, sizeof(*python) * (count + 1));
+	other = arena_alloc(lint_arena, sizeof(*other) * (count + 1));
+	if (!python || !other)
+		return;
+	for (i = 0; i < count; i++)
+	{
+		record = map_put(prepared, paths[i], NULL);
+		if (!record || record->queued)
+			continue;
+		/* Stays unready, and so linted alone later, if the batch fails */
+		record->queued = 1;
+		if (is_python_file(paths[i]))
+			python[python_count++] = paths[i];
+		else
+			other[other_count++] = paths[i];
+	}
+	if (prepare_group(python, python_count, 1) + prepare_group(other, other_count, 0) > 0)
+		lint_cache_prune();
+}
+
+/**
+ * lint_replay - Reports a file's prepared lint messages.
+ * @filepath: File about to be linted
+ * @found_issues: Set to 1 if the linter had anything to say
+ *
+ * Return: 1 if the file was prepared and its messages were reported, 0 if
+ * it has to be linted now
+ */
+int lint_replay(const char *filepath, int *found_issues)
+{
+	const LintRecord *record;
+	int i;
+
+	record = prepared ? map_get(prepared, filepath) : NULL;
+	if (!record || !record->ready)
+		return 0;
+	for (i = 0; i < record->count; i++)
+		report_error("%s: %s:%s", record->label, filepath, record->lines[i]);
+	*found_issues = record->count > 0;
+	return 1;
+}
+
+void lint_clear(void)
+{
+	map_free(prepared);
+	arena_destroy(lint_arena);
+	prepared = NULL;
+	lint_arena = NULL;
+}
@@ -0,0 +1,345 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <openssl/sha.h>
+#include "linters.h"
+#include "../../utils/utils.h"
+
+/*
+ * Lint results by content, shared by every student and run. An entry in
+ * LINT_CACHE is named by the SHA-256 of the file's contents, the linter and
+ * the linter's identity: for pycodestyle the version and options the lint
+ * worker reports, for betty its scripts and checkpatch configuration. It
+ * holds the linter's messages without the "path:" prefix, so a template
+ * file copied by many students is linted once. Hits refresh the entry's
+ * mtime and lint_cache_prune() removes the least recently used entries
+ * once the directory outgrows LINT_CACHE_BUDGET_MB.
+ */
+
+typedef struct {
+	const char *name;
+	int state;                      /* 0 not looked up, 1 known, -1 not cacheable */
+	char digest[LINT_KEY_LENGTH];
+} LinterIdentity;
+
+typedef struct {
+	char name[LINT_KEY_LENGTH];
+	long mtime;
+	long size;
+} CacheEntry;
+
+static LinterIdentity identities[] = {
+	{ "pycodestyle", 0, "" },
+	{ "betty", 0, "" },
+};
+
+static void hash_field(SHA256_CTX *sha, const char *value)
+{
+	if (value)
+		SHA256_Update(sha, value, strlen(value));
+	/* Field separator, so ("ab", "c") and ("a", "bc") differ */
+	SHA256_Update(sha, "", 1);
+}
+
+/* Adds @path's contents, or just a separator if it cannot be read */
+static void hash_file(SHA256_CTX *sha, const char *path)
+{
+	char buffer[4096];
+	size_t n;
+	FILE *fp;
+
+	hash_field(sha, path);
+	fp = fopen(path, "rb");
+	if (fp)
+	{
+		while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+			SHA256_Update(sha, buffer, n);
+		fclose(fp);
+	}
+	hash_field(sha, NULL);
+}
+
+static void to_hex(const unsigned char *digest, char *hex)
+{
+	int i;
+
+	for (i = 0; i < SHA256_DIGEST_LENGTH; i++)
+		sprintf(hex + i * 2, "%02x", digest[i]);
+	hex[SHA256_DIGEST_LENGTH * 2] = '\0';
+}
+
+/* Full path of @name in $PATH, 1 if it is not installed */
+static int find_program(const char *name, char *path, size_t size)
+{
+	const char *dir, *end;
+	size_t len;
+
+	dir = getenv("PATH");
+	while (dir && *dir)
+	{
+		end = strchr(dir, ':');
+		len = end ? (size_t)(end - dir) : strlen(dir);
+		snprintf(path, size, "%.*s/%s", (int)len, dir, name);
+		if (len > 0 && access(path, X_OK) == 0)
+			return 0;
+		dir = end ? end + 1 : NULL;
+	}
+	return 1;
+}
+
+static int pycodestyle_identity(SHA256_CTX *sha)
+{
+	const char *version;
+	Arena *arena;
+
+	/* Only the worker says what it lints with; pycodestyle run by hand is not cached */
+	arena = arena_create();
+	version = arena ? lint_worker_version(arena) : NULL;
+	if (version)
+		hash_field(sha, version);
+	arena_destroy(arena);
+	return version ? 0 : 1;
+}
+
+static int betty_identity(SHA256_CTX *sha)
+{
+	static const char *const scripts[] = { "betty", "betty-style", "betty-doc", NULL };
+	char path[1024];
+	const char *home;
+	int i;
+
+	if (find_program("betty", path, sizeof(path)) != 0)
+		return 1;
+	for (i = 0; scripts[i]; i++)
+	{
+		if (find_program(scripts[i], path, sizeof(path)) == 0)
+			hash_file(sha, path);
+		else
+			hash_field(sha, scripts[i]);
+	}
+	/* checkpatch reads .checkpatch.conf from the working and home directories */
+	hash_file(sha, ".checkpatch.conf");
+	home = getenv("HOME");
+	snprintf(path, sizeof(path), "%s/.checkpatch.conf", home ? home : "");
+	hash_file(sha, path);
+	return 0;
+}
+
+static LinterIdentity *linter_identity(const char *linter)
+{
+	unsigned char digest[SHA256_DIGEST_LENGTH];
+	LinterIdentity *id = NULL;
+	SHA256_CTX sha;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < sizeof(identities) / sizeof(identities[0]); i++)
+	{
+		if (strcmp(identities[i].name, linter) == 0)
+			id = &identities[i];
+	}
+	if (!id || id->state != 0)
+		return id;
+
+	SHA256_Init(&sha);
+	hash_field(&sha, linter);
+	ret = strcmp(linter, "pycodestyle") == 0 ? pycodestyle_identity(&sha) : betty_identity(&sha);
+	SHA256_Final(digest, &sha);
+	to_hex(digest, id->digest);
+	id->state = ret == 0 ? 1 : -1;
+	return id;
+}
+
+/**
+ * lint_cache_identity - Identifies both linters at once.
+ *
+ * Digest of the pycodestyle and betty identities lint_cache_key() uses,
+ * for caches whose entries hold lint output among other things. A linter
+ * whose identity is unknown only contributes its name.
+ *
+ * Return: LINT_KEY_LENGTH bytes of lowercase hex, valid for the process
+ */
+const char *lint_cache_identity(void)
+{
+	static char identity[LINT_KEY_LENGTH];
+	unsigned char digest[SHA256_DIGEST_LENGTH];
+	const LinterIdentity *id;
+	SHA256_CTX sha;
+	size_t i;
+
+	if (*identity)
+		return identity;
+	SHA256_Init(&sha);
+	for (i = 0; i < sizeof(identities) / sizeof(identities[0]); i++)
+	{
+		id = linter_identity(identities[i].name);
+		hash_field(&sha, id->name);
+		hash_field(&sha, id->state == 1 ? id->digest : "");
+	}
+	SHA256_Final(digest, &sha);
+	to_hex(digest, identity);
+	return identity;
+}
+
+/**
+ * lint_cache_key - Computes the cache key of a file for one linter.
+ * @linter: "pycodestyle" or "betty"
+ * @filepath: File about to be linted
+ * @key: Receives LINT_KEY_LENGTH bytes of lowercase hex
+ *
+ * Return: 0 on success, 1 if caching is off or the file or the linter's
+ * identity is unknown
+ */
+int lint_cache_key(const char *linter, const char *filepath, char *key)
+{
+	unsigned char digest[SHA256_DIGEST_LENGTH];
+	const LinterIdentity *id;
+	CachedFile *file;
+	SHA256_CTX sha;
+
+	if (!result_cache_enabled)
+		return 1;
+	file = file_cache_load(filepath);
+	if (!file || file->is_dir)
+		return 1;
+	id = linter_identity(linter);
+	if (!id || id->state != 1)
+		return 1;
+
+	SHA256_Init(&sha);
+	hash_field(&sha, file_cache_hash(file));
+	hash_field(&sha, linter);
+	hash_field(&sha, id->digest);
+	SHA256_Final(digest, &sha);
+	to_hex(digest, key);
+	return 0;
+}
+
+/**
+ * lint_cache_open - Looks up stored lint messages.
+ * @key: From lint_cache_key()
+ *
+ * Return: Stream of the messages, one per line without the file's path,
+ * NULL on a miss
+ */
+FILE *lint_cache_open(const char *key)
+{
+	char path[512];
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/%s", LINT_CACHE, key);
+	fp = fopen(path, "r");
+	/* Recently used entries are the last to be evicted */
+	if (fp)
+		utime(path, NULL);
+	return fp;
+}
+
+/**
+ * lint_cache_store - Saves a file's lint messages for later runs.
+ * @key: From lint_cache_key()
+ * @lines: Messages without the file's path, each ending in a newline
+ * @count: Number of messages, 0 for a clean file
+ *
+ * Written to a temporary file and renamed into place like result entries.
+ *
+ * Return: 0 on success, 1 otherwise
+ */
+int lint_cache_store(const char *key, const char *const *lines, int count)
+{
+	char path[512], tmp[600];
+	FILE *fp;
+	int i, ok;
+
+	mkdir(CACHE_DIR, 0755);
+	mkdir(LINT_CACHE, 0755);
+	snprintf(path, sizeof(path), "%s/%s", LINT_CACHE, key);
+	snprintf(tmp, sizeof(tmp), "%s/%s.%ld.tmp", LINT_CACHE, key, (long)getpid());
+
+	fp = fopen(tmp, "w");
+	if (!fp)
+		return 1;
+	for (i = 0; i < count; i++)
+		fputs(lines[i], fp);
+	ok = !ferror(fp);
+	if (fclose(fp) != 0)
+		ok = 0;
+	if (!ok || rename(tmp, path) != 0)
+	{
+		unlink(tmp);
+		return 1;
+	}
+	return 0;
+}
+
+static int by_mtime(const void *a, const void *b)
+{
+	const CacheEntry *x = a, *y = b;
+
+	return x->mtime < y->mtime ? -1 : x->mtime > y->mtime;
+}
+
+/**
+ * lint_cache_prune - Keeps the lint cache within LINT_CACHE_BUDGET_MB.
+ *
+ * Removes least recently used entries down to nine tenths of the budget,
+ * so that a full cache is not scanned again after every store. Skipped if
+ * another process is pruning already.
+ */
+void lint_cache_prune(void)
+{
+	char path[512];
+	CacheEntry *entries = NULL, *grown;
+	struct dirent *de;
+	struct stat st;
+	long total = 0, budget;
+	int fd, i, count = 0, capacity = 0;
+	DIR *dir;
+
+	fd = lock_path(LINT_CACHE_LOCK, LOCK_EX | LOCK_NB);
+	if (fd < 0)
+		return;
+	dir = opendir(LINT_CACHE);
+	while (dir && (de = readdir(dir)) != NULL)
+	{
+		/* Temporary files of running stores are left alone */
+		if (strlen(de->d_name) != LINT_KEY_LENGTH - 1)
+			continue;
+		snprintf(path, sizeof(path), "%s/%s", LINT_CACHE, de->d_name);
+		if (stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+			continue;
+		if (count == capacity)
+		{
+			capacity = capacity ? capacity * 2 : 256;
+			grown = realloc(entries, capacity * sizeof(*grown));
+			if (!grown)
+				break;
+			entries = grown;
+		}
+		strcpy(entries[count].name, de->d_name);
+		entries[count].mtime = (long)st.st_mtime;
+		entries[count].size = (long)st.st_blocks * 512;
+		total += entries[count++].size;
+	}
+	if (dir)
+		closedir(dir);
+
+	budget = (long)LINT_CACHE_BUDGET_MB * 1024 * 1024;
+	if (total > budget)
+	{
+		qsort(entries, count, sizeof(*entries), by_mtime);
+		for (i = 0; i < count && total > budget - budget / 10; i++)
+		{
+			snprintf(path, sizeof(path), "%s/%s", LINT_CACHE, entries[i].name);
+			if (unlink(path) == 0)
+				total -= entries[i].size;
+		}
+	}
+	free(entries);
+	unlock_path(fd);
+}
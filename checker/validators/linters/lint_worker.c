@@ -0,0 +1,393 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "linters.h"
+#include "../../utils/utils.h"
+
+/*
+ * Client of the long-lived pycodestyle worker (LINT_WORKER next to the
+ * executable, or $CHECKER_LINT_WORKER). The top-level
+ * checker process starts it once; forked task processes inherit the socket
+ * and take turns on it under an fcntl() lock, which unlike flock() is held
+ * per process and so excludes forked siblings sharing one descriptor.
+ * Every exchange carries a request id, so a reply left behind by a process
+ * killed mid-request is detected rather than misread. A worker that dies,
+ * hangs or answers garbage is killed and replaced (by a private worker in
+ * a forked process, the owner replaces its own on the next
+ * lint_worker_start()), and the request is sent once more; if that fails
+ * too the caller runs pycodestyle itself.
+ */
+
+#define FRAME_HEADER_MAX 64
+#define FRAME_PAYLOAD_MAX (16 * 1024 * 1024)
+
+static struct {
+	pid_t pid;         /* 0 when there is no worker */
+	pid_t owner;       /* process that started it and may reap it */
+	int fd;            /* our end of the socket */
+	FILE *lock;        /* anonymous file whose fcntl() lock serialises requests */
+	int unavailable;   /* the worker cannot lint here, always fall back */
+	unsigned int next_id;
+} worker = { 0, 0, -1, NULL, 0, 0 };
+
+static void close_worker(void)
+{
+	int status;
+
+	if (worker.pid > 0)
+	{
+		kill(worker.pid, SIGKILL);
+		if (worker.owner == getpid())
+			waitpid(worker.pid, &status, 0);
+	}
+	if (worker.fd >= 0)
+		close(worker.fd);
+	worker.pid = 0;
+	worker.fd = -1;
+}
+
+/*
+ * The worker script: $CHECKER_LINT_WORKER if set, otherwise LINT_WORKER next
+ * to the checker executable, so it is found whatever the working directory
+ */
+static const char *worker_script(void)
+{
+	static char path[PATH_MAX + sizeof(LINT_WORKER)];
+	char exe[PATH_MAX];
+	const char *env;
+	char *slash;
+	ssize_t len;
+
+	env = getenv("CHECKER_LINT_WORKER");
+	if (env && *env)
+		return env;
+	if (*path)
+		return path;
+	len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+	if (len <= 0)
+		return LINT_WORKER;
+	exe[len] = '\0';
+	slash = strrchr(exe, '/');
+	if (!slash)
+		return LINT_WORKER;
+	*slash = '\0';
+	snprintf(path, sizeof(path), "%s/%s", exe, LINT_WORKER);
+	return path;
+}
+
+static int spawn_worker(void)
+{
+	const char *script = worker_script();
+	int sv[2];
+	pid_t pid;
+
+	if (access(script, R_OK) != 0)
+	{
+		worker.unavailable = 1;
+		return 1;
+	}
+	if (!worker.lock)
+	{
+		worker.lock = tmpfile();
+		if (!worker.lock)
+			return 1;
+		fcntl(fileno(worker.lock), F_SETFD, FD_CLOEXEC);
+	}
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+		return 1;
+
+	pid = fork();
+	if (pid < 0)
+	{
+		close(sv[0]);
+		close(sv[1]);
+		return 1;
+	}
+	if (pid == 0)
+	{
+		dup2(sv[1], STDIN_FILENO);
+		dup2(sv[1], STDOUT_FILENO);
+		close(sv[0]);
+		close(sv[1]);
+		execlp("python3", "python3", script, (char *)NULL);
+		_exit(127);
+	}
+
+	close(sv[1]);
+	/* Student programs and other tools must not hold the worker open */
+	fcntl(sv[0], F_SETFD, FD_CLOEXEC);
+	worker.pid = pid;
+	worker.owner = getpid();
+	worker.fd = sv[0];
+	return 0;
+}
+
+/**
+ * lint_worker_start - Starts the lint worker unless one is running.
+ *
+ * Called by the top-level process before it forks task or job processes,
+ * so they all share one worker; a worker that has exited is replaced.
+ * Startup is not waited for, the interpreter loads while repositories are
+ * fetched.
+ */
+void lint_worker_start(void)
+{
+	int status;
+
+	if (worker.pid > 0 && waitpid(worker.pid, &status, WNOHANG) == 0)
+		return;
+	/* Exited, or already reaped by a SIGCHLD handler: just forget it */
+	if (worker.fd >= 0)
+		close(worker.fd);
+	worker.pid = 0;
+	worker.fd = -1;
+	spawn_worker();
+}
+
+/**
+ * lint_worker_stop - Shuts the worker down, only in the process that owns it.
+ */
+void lint_worker_stop(void)
+{
+	int status;
+
+	if (worker.pid <= 0 || worker.owner != getpid())
+		return;
+	/* End of input makes the worker exit on its own */
+	close(worker.fd);
+	waitpid(worker.pid, &status, 0);
+	worker.pid = 0;
+	worker.fd = -1;
+}
+
+static int lock_worker(int type)
+{
+	struct flock fl;
+
+	memset(&fl, 0, sizeof(fl));
+	fl.l_type = type;
+	fl.l_whence = SEEK_SET;
+	while (fcntl(fileno(worker.lock), F_SETLKW, &fl) != 0)
+	{
+		if (errno != EINTR)
+			return 1;
+	}
+	return 0;
+}
+
+static int send_all(const char *data, size_t size)
+{
+	ssize_t n;
+
+	while (size > 0)
+	{
+		/* No SIGPIPE if the worker is gone, just an error */
+		n = send(worker.fd, data, size, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return 1;
+		data += n;
+		size -= n;
+	}
+	return 0;
+}
+
+/* Reads exactly @size bytes, or up to a newline when @line is set */
+static int recv_until(char *buf, size_t size, int line, time_t deadline)
+{
+	struct pollfd pfd;
+	size_t got = 0;
+	ssize_t n;
+	int left, ready;
+
+	pfd.fd = worker.fd;
+	pfd.events = POLLIN;
+	while (got < size)
+	{
+		left = (int)(deadline - time(NULL));
+		if (left <= 0)
+			return 1;
+		ready = poll(&pfd, 1, left * 1000);
+		if (ready < 0 && errno == EINTR)
+			continue;
+		if (ready <= 0)
+			return 1;
+		n = recv(worker.fd, buf + got, line ? 1 : size - got, 0);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return 1;
+		got += n;
+		if (line && buf[got - 1] == '\n')
+		{
+			buf[got - 1] = '\0';
+			return 0;
+		}
+	}
+	/* A header that fills the buffer without a newline is garbage */
+	return line ? 1 : 0;
+}
+
+/* Splits "<index>\t<row>\t<col>\t<text>" lines into @results[index] */
+static int parse_diagnostics(char *payload, Arena *arena, LintResult *results, int count)
+{
+	LintDiagnostic *d;
+	char *line, *next, *field;
+	long index;
+	int i;
+
+	/* Counted first, each file's findings are one array */
+	for (line = payload; *line; line = next + 1)
+	{
+		next = strchr(line, '\n');
+		index = strtol(line, &field, 10);
+		if (!next || *field != '\t' || index < 0 || index >= count)
+			return 1;
+		results[index].count++;
+	}
+	for (i = 0; i < count; i++)
+	{
+		results[i].diagnostics = arena_alloc(arena, sizeof(*d) * (results[i].count + 1));
+		if (!results[i].diagnostics)
+			return 1;
+		results[i].count = 0;
+	}
+	for (line = payload; *line; line = next)
+	{
+		next = strchr(line, '\n');
+		*next++ = '\0';
+		index = strtol(line, &field, 10);
+		d = &results[index].diagnostics[results[index].count++];
+		d->line = (int)strtol(field + 1, &field, 10);
+		if (*field != '\t')
+			return 1;
+		d->column = (int)strtol(field + 1, &field, 10);
+		if (*field != '\t')
+			return 1;
+		d->text = field + 1;
+	}
+	return 0;
+}
+
+/*
+ * One request and its reply: 0 with the reply's body in @reply, 1 if the
+ * worker answered that it cannot serve the request, -1 if it is broken
+ */
+static int exchange(const char *verb, const char **paths, int count, Arena *arena, char **reply)
+{
+	char header[FRAME_HEADER_MAX], status[16], *payload;
+	unsigned int id, reply_id;
+	unsigned long length = 0;
+	int i;
+
+	/* Paths are sent NUL-separated */
+	for (i = 0; i < count; i++)
+		length += strlen(paths[i]) + 1;
+	id = ((unsigned int)getpid() << 12) ^ ++worker.next_id;
+	snprintf(header, sizeof(header), "%u %s %lu\n", id, verb, length);
+	if (send_all(header, strlen(header)) != 0)
+		return -1;
+	for (i = 0; i < count; i++)
+	{
+		if (send_all(paths[i], strlen(paths[i]) + 1) != 0)
+			return -1;
+	}
+
+	if (recv_until(header, sizeof(header), 1, time(NULL) + LINT_WORKER_TIMEOUT) != 0 ||
+			sscanf(header, "%u %15s %lu", &reply_id, status, &length) != 3 ||
+			reply_id != id || length > FRAME_PAYLOAD_MAX)
+		return -1;
+	payload = arena_alloc(arena, length + 1);
+	if (!payload || recv_until(payload, length, 0, time(NULL) + LINT_WORKER_TIMEOUT) != 0)
+		return -1;
+	payload[length] = '\0';
+
+	if (strcmp(status, "unavailable") == 0)
+	{
+		worker.unavailable = 1;
+		return 1;
+	}
+	if (strcmp(status, "error") == 0)
+		return 1;
+	if (strcmp(status, "ok") != 0)
+		return -1;
+	*reply = payload;
+	return 0;
+}
+
+/* exchange() under the lock, with one more try on a fresh worker */
+static int request(const char *verb, const char **paths, int count, Arena *arena, char **reply)
+{
+	int attempt, ret = -1;
+
+	for (attempt = 0; attempt < 2 && ret < 0 && !worker.unavailable; attempt++)
+	{
+		/* A worker killed by the last attempt is replaced */
+		if (worker.pid <= 0 && spawn_worker() != 0)
+			break;
+		if (lock_worker(F_WRLCK) != 0)
+			break;
+		ret = exchange(verb, paths, count, arena, reply);
+		if (ret < 0)
+			close_worker();
+		lock_worker(F_UNLCK);
+	}
+	return ret;
+}
+
+/**
+ * lint_worker_lint - Lints files with the shared pycodestyle worker.
+ * @paths: Python files to lint, all in one request
+ * @count: Number of paths
+ * @arena: Arena the diagnostics are allocated from
+ * @results: @count results, filled with each file's diagnostics in
+ * pycodestyle's order
+ *
+ * Return: 0 on success, -1 if no worker could lint the files; the caller
+ * then runs pycodestyle itself
+ */
+int lint_worker_lint(const char **paths, int count, Arena *arena, LintResult *results)
+{
+	char *reply;
+
+	memset(results, 0, sizeof(*results) * count);
+	if (request("lint", paths, count, arena, &reply) != 0)
+		return -1;
+	if (parse_diagnostics(reply, arena, results, count) != 0)
+	{
+		/* A worker that answers garbage is not trusted again */
+		if (lock_worker(F_WRLCK) == 0)
+		{
+			close_worker();
+			lock_worker(F_UNLCK);
+		}
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * lint_worker_version - Describes the pycodestyle the worker lints with.
+ * @arena: Arena the description is allocated from
+ *
+ * Return: pycodestyle's version and the options in effect, one per line,
+ * or NULL if there is no working worker
+ */
+const char *lint_worker_version(Arena *arena)
+{
+	char *reply;
+
+	if (request("version", NULL, 0, arena, &reply) != 0)
+		return NULL;
+	return reply;
+}
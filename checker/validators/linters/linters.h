@@ -1,9 +1,38 @@
 #ifndef LINTERS_H
 #define LINTERS_H
 
+#include "../../main/checker.h"
+
+#define LINT_KEY_LENGTH 65
+
+/* One pycodestyle finding, text is "<code> <message>" */
+typedef struct {
+	int line;
+	int column;
+	const char *text;
+} LintDiagnostic;
+
+typedef struct {
+	LintDiagnostic *diagnostics;
+	int count;
+} LintResult;
+
 int check_readme(const char *path);
 int is_python_file(const char *filename);
 int run_betty_linter(const char *filepath);
 int run_pycodestyle(const char *filepath);
+void lint_worker_start(void);
+void lint_worker_stop(void);
+int lint_worker_lint(const char **paths, int count, Arena *arena, LintResult *results);
+const char *lint_worker_version(Arena *arena);
+const char *lint_cache_identity(void);
+int lint_cache_key(const char *linter, const char *filepath, char *key);
+FILE *lint_cache_open(const char *key);
+int lint_cache_store(const char *key, const char *const *lines, int count);
+void lint_cache_prune(void);
+int lint_is_banner(const char *line);
+void lint_prepare(const char **paths, int count);
+int lint_replay(const char *filepath, int *found_issues);
+void lint_clear(void);
 
 #endif
@@ -1,4 +1,5 @@
 #include "linters.h"
+#include "../../reporter/reporter.h"
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -8,17 +9,24 @@ int run_betty_linter(const char *filepath)
 	char cmd[1024];
 	char buffer[1024];
 	int found_issues = 0;
+
+	/* Linted with the rest of the job by lint_prepare() */
+	if (lint_replay(filepath, &found_issues))
+		return found_issues;
 	snprintf(cmd, sizeof(cmd), "betty %s", filepath);
 
 	fp = popen(cmd, "r");
 	if (!fp) {
-		perror("popen");
+		report_perror("popen");
 		return 1;
 	}
 
 
 	while (fgets(buffer, sizeof(buffer), fp)) {
-		fprintf(stderr, "Betty: %s", buffer);
+		/* The file banner is printed even when there is nothing to say */
+		if (lint_is_banner(buffer))
+			continue;
+		report_error("Betty: %s", buffer);
 		found_issues = 1;
 	}
 
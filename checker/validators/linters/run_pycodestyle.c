@@ -1,23 +1,54 @@
 #include "linters.h"
+#include "../../reporter/reporter.h"
+#include "../../utils/utils.h"
 #include <stdio.h>
 #include <stdlib.h>
 
+/* Lints through the shared worker, -1 if it could not */
+static int lint_with_worker(const char *filepath)
+{
+	LintResult result;
+	Arena *arena;
+	int i, ret = -1;
+
+	arena = arena_create();
+	if (arena && lint_worker_lint(&filepath, 1, arena, &result) == 0)
+	{
+		/* Same lines as the pycodestyle command prints */
+		for (i = 0; i < result.count; i++)
+			report_error("Pycodestyle: %s:%d:%d: %s\n", filepath,
+					result.diagnostics[i].line, result.diagnostics[i].column,
+					result.diagnostics[i].text);
+		ret = result.count > 0;
+	}
+	if (arena)
+		arena_destroy(arena);
+	return ret;
+}
+
 int run_pycodestyle(const char *filepath)
 {
 	FILE *fp;
 	char cmd[1024];
 	char buffer[1024];
 	int found_issues = 0;
+
+	if (lint_replay(filepath, &found_issues))
+		return found_issues;
+	found_issues = lint_with_worker(filepath);
+	if (found_issues >= 0)
+		return found_issues;
+	found_issues = 0;
 	snprintf(cmd, sizeof(cmd), "pycodestyle %s", filepath);
 
 	fp = popen(cmd, "r");
 	if (!fp) {
-		perror("popen");
+		report_perror("popen");
 		return 1;
 	}
 
 	while (fgets(buffer, sizeof(buffer), fp)) {
-		fprintf(stderr, "Pycodestyle: %s", buffer);
+		report_error("Pycodestyle: %s", buffer);
 		found_issues = 1;
 	}
 
@@ -0,0 +1,51 @@
+#ifndef PLUGIN_API_H
+#define PLUGIN_API_H
+
+/*
+ * ABI between the checker and validator plugins. A plugin is a shared
+ * object in the plugin directory (see --plugins) that exports
+ *
+ *   const CheckerPlugin checker_plugin = { CHECKER_PLUGIN_ABI, ... };
+ *
+ * Plugins built against another CHECKER_PLUGIN_ABI are refused. Bump it
+ * whenever a structure below changes; only append fields to CheckerHost.
+ */
+
+#include <stddef.h>
+
+#define CHECKER_PLUGIN_ABI 2
+#define CHECKER_PLUGIN_SYMBOL "checker_plugin"
+
+/* Services the checker offers plugins, passed to CheckerPlugin.init */
+typedef struct {
+	unsigned int abi_version;
+	void (*report_info)(const char *format, ...);
+	void (*report_error)(const char *format, ...);
+	void (*report_progress)(unsigned int delay_us, const char *format, ...);
+	/* Checks @filepath against a catalog-style "rules" object given as JSON text */
+	int (*check_rules)(const char *rules_json, const char *task_name, const char *filepath);
+	/*
+	 * Contents of @filepath from the checker's per-run file cache, shared with
+	 * every other check of the file; not NUL-terminated. NULL if it cannot be read.
+	 */
+	const char *(*read_file)(const char *filepath, size_t *size);
+} CheckerHost;
+
+/* Same contract as a built-in validator: 0 if @filepath passes, 1 otherwise */
+typedef int (*CheckerValidateFn)(const char *filepath);
+
+typedef struct {
+	const char *task_name;
+	CheckerValidateFn validate;
+} CheckerPluginValidator;
+
+typedef struct {
+	unsigned int abi_version;
+	const char *name;
+	/* Called once after loading, may be NULL; non-zero refuses the plugin */
+	int (*init)(const CheckerHost *host);
+	/* Terminated by an entry with a NULL task_name */
+	const CheckerPluginValidator *validators;
+} CheckerPlugin;
+
+#endif
@@ -0,0 +1,295 @@
+#include <stdlib.h>
+#include <string.h>
+#include <json-c/json.h>
+#include "rules.h"
+#include "../../utils/utils.h"
+#include "../../reporter/reporter.h"
+#include "../../trace/trace.h"
+
+/*
+ * Compiles the "rules" object of a catalog task into a RuleSet. Compiled
+ * sets are cached by their JSON text for the life of the process, so each
+ * distinct rule set is compiled once however many files it checks.
+ */
+
+static Arena *cache_arena;
+static HashMap *compiled; /* rules JSON -> RuleSet * */
+
+static const char **string_array(struct json_object *value, Arena *arena,
+		const char *rule, int *count)
+{
+	const char **items;
+	const char *str;
+	int i, n;
+
+	if (!json_object_is_type(value, json_type_array))
+	{
+		report_error("Error: rule '%s' must be an array of strings\n", rule);
+		return NULL;
+	}
+	n = json_object_array_length(value);
+	items = arena_alloc(arena, sizeof(*items) * (n + 1));
+	if (!items)
+		return NULL;
+	for (i = 0; i < n; i++)
+	{
+		str = json_object_get_string(json_object_array_get_idx(value, i));
+		if (!str || !json_object_is_type(json_object_array_get_idx(value, i), json_type_string))
+		{
+			report_error("Error: rule '%s' must be an array of strings\n", rule);
+			return NULL;
+		}
+		items[i] = arena_intern(arena, str);
+		if (!items[i])
+			return NULL;
+	}
+	*count = n;
+	return items;
+}
+
+/* Builds the Aho-Corasick automaton over the banned tokens */
+static int build_automaton(RuleSet *rules, Arena *arena)
+{
+	uint16_t *fail = NULL, *queue = NULL;
+	const unsigned char *token;
+	int states = 1, max_states = 1, i, c, s, head = 0, tail = 0;
+	uint16_t child, f;
+
+	for (i = 0; i < rules->banned_count; i++)
+	{
+		/* Such tokens could never be found in code */
+		if (rules->banned[i][strcspn(rules->banned[i], "#'\"\n")] != '\0' ||
+				rules->banned[i][0] == '\0')
+		{
+			report_error("Error: banned token '%s' is empty or contains #, a quote or a newline\n",
+					rules->banned[i]);
+			return 1;
+		}
+		max_states += strlen(rules->banned[i]);
+		for (token = (const unsigned char *)rules->banned[i]; *token; token++)
+		{
+			if (!rules->classes[*token])
+				rules->classes[*token] = ++rules->class_count;
+		}
+	}
+	rules->class_count++;
+	if (max_states > RULES_MAX_STATES)
+	{
+		report_error("Error: rule 'banned' is too large\n");
+		return 1;
+	}
+
+	rules->next = arena_alloc(arena, sizeof(*rules->next) * max_states * rules->class_count);
+	rules->match = arena_alloc(arena, sizeof(*rules->match) * max_states);
+	rules->match_link = arena_alloc(arena, sizeof(*rules->match_link) * max_states);
+	fail = calloc(max_states, sizeof(*fail));
+	queue = malloc(sizeof(*queue) * max_states);
+	if (!rules->next || !rules->match || !rules->match_link || !fail || !queue)
+	{
+		free(fail);
+		free(queue);
+		return 1;
+	}
+	for (s = 0; s < max_states; s++)
+		rules->match[s] = -1;
+
+	/* Trie: next[] holds only the goto edges for now, 0 meaning none */
+	for (i = 0; i < rules->banned_count; i++)
+	{
+		s = 0;
+		for (token = (const unsigned char *)rules->banned[i]; *token; token++)
+		{
+			c = rules->classes[*token];
+			if (!rules->next[s * rules->class_count + c])
+				rules->next[s * rules->class_count + c] = states++;
+			s = rules->next[s * rules->class_count + c];
+		}
+		if (rules->match[s] < 0)
+			rules->match[s] = i;
+	}
+
+	/* Breadth first, turning missing edges into failure transitions */
+	for (c = 0; c < rules->class_count; c++)
+	{
+		child = rules->next[c];
+		if (child)
+			queue[tail++] = child;
+	}
+	while (head < tail)
+	{
+		s = queue[head++];
+		f = fail[s];
+		rules->match_link[s] = rules->match[f] >= 0 ? f : rules->match_link[f];
+		for (c = 0; c < rules->class_count; c++)
+		{
+			child = rules->next[s * rules->class_count + c];
+			if (child)
+			{
+				fail[child] = rules->next[f * rules->class_count + c];
+				queue[tail++] = child;
+			}
+			else
+			{
+				rules->next[s * rules->class_count + c] = rules->next[f * rules->class_count + c];
+			}
+		}
+	}
+	/* Flag transitions into states where a token ends */
+	for (i = 0; i < states * rules->class_count; i++)
+	{
+		s = rules->next[i];
+		if (rules->match[s] >= 0 || rules->match_link[s])
+			rules->next[i] |= RULES_STATE_MATCH;
+	}
+	rules->classes['\n'] = rules->classes['#'] = RULES_CLASS_LEXER;
+	rules->classes['"'] = rules->classes['\''] = RULES_CLASS_LEXER;
+	rules->state_count = states;
+
+	/* Bytes that move the root anywhere; the rest can be skipped over */
+	for (i = 0; i < 256; i++)
+	{
+		c = rules->classes[i];
+		if (c != RULES_CLASS_LEXER && !(rules->next[c] & ~RULES_STATE_MATCH))
+			continue;
+		if (rules->start_count == RULES_MAX_STARTS)
+		{
+			rules->start_count = 0;
+			break;
+		}
+		rules->starts[rules->start_count++] = (unsigned char)i;
+	}
+	free(fail);
+	free(queue);
+	return 0;
+}
+
+/**
+ * rules_compile - Compiles a task's rules.
+ * @json: The task's "rules" object as JSON text
+ * @arena: Arena the rule set is allocated from
+ *
+ * Return: The rule set, NULL (after reporting why) if the rules are invalid
+ */
+RuleSet *rules_compile(const char *json, Arena *arena)
+{
+	struct json_object_iterator it, end;
+	struct json_object *parsed, *value;
+	const char *docstring, *key;
+	RuleSet *rules;
+	int ok = 1;
+
+	parsed = json_tokener_parse(json);
+	rules = arena_alloc(arena, sizeof(*rules));
+	if (!parsed || !json_object_is_type(parsed, json_type_object) || !rules)
+	{
+		report_error("Error: task rules must be a JSON object\n");
+		json_object_put(parsed);
+		return NULL;
+	}
+
+	it = json_object_iter_begin(parsed);
+	end = json_object_iter_end(parsed);
+	for (; ok && !json_object_iter_equal(&it, &end); json_object_iter_next(&it))
+	{
+		key = json_object_iter_peek_name(&it);
+		value = json_object_iter_peek_value(&it);
+		if (strcmp(key, "header") == 0)
+		{
+			rules->header = string_array(value, arena, key, &rules->header_count);
+			ok = rules->header != NULL;
+		}
+		else if (strcmp(key, "signature") == 0)
+		{
+			rules->signature = json_object_is_type(value, json_type_string) ?
+				arena_intern(arena, json_object_get_string(value)) : NULL;
+			ok = rules->signature != NULL;
+		}
+		else if (strcmp(key, "docstring") == 0)
+		{
+			docstring = json_object_get_string(value);
+			if (docstring && strcmp(docstring, "module") == 0)
+				rules->docstring = DOCSTRING_MODULE;
+			else if (docstring && strcmp(docstring, "definition") == 0)
+				rules->docstring = DOCSTRING_DEFINITION;
+			else
+				ok = docstring && strcmp(docstring, "none") == 0;
+		}
+		else if (strcmp(key, "banned") == 0)
+		{
+			rules->banned = string_array(value, arena, key, &rules->banned_count);
+			ok = rules->banned != NULL;
+		}
+		else if (strcmp(key, "required_files") != 0)
+		{
+			report_error("Error: unknown rule '%s'\n", key);
+			ok = 0;
+			break;
+		}
+		if (!ok)
+			report_error("Error: invalid value for rule '%s'\n", key);
+	}
+	json_object_put(parsed);
+
+	if (ok && rules->docstring == DOCSTRING_DEFINITION && !rules->signature)
+	{
+		report_error("Error: a \"definition\" docstring rule needs a signature\n");
+		ok = 0;
+	}
+	if (!ok || build_automaton(rules, arena) != 0)
+		return NULL;
+	return rules;
+}
+
+/**
+ * rules_check - Checks a file against rules given as JSON text.
+ * @json: A "rules" object as JSON text, see rules.h
+ * @task_name: Task the file belongs to
+ * @filepath: File to check
+ *
+ * Compiled sets are kept for the life of the process, keyed by @json.
+ *
+ * Return: 0 if the file passes, 1 otherwise
+ */
+int rules_check(const char *json, const char *task_name, const char *filepath)
+{
+	RuleSet **slot;
+
+	if (!compiled)
+	{
+		cache_arena = arena_create();
+		compiled = cache_arena ? map_create(sizeof(RuleSet *), cache_arena) : NULL;
+		if (!compiled)
+		{
+			report_error("Error: out of memory compiling rules\n");
+			return 1;
+		}
+	}
+
+	slot = map_put(compiled, json, NULL);
+	if (!slot)
+		return 1;
+	if (!*slot)
+	{
+		TRACE_BEGIN("rules_compile", task_name);
+		*slot = rules_compile(json, cache_arena);
+		TRACE_END("rules_compile");
+		if (!*slot)
+		{
+			report_error("Error: invalid rules for task %s\n", task_name);
+			return 1;
+		}
+	}
+	return rules_check_file(*slot, task_name, filepath);
+}
+
+/**
+ * validate_with_rules - Checks a task file against the task's catalog rules.
+ * @task: Task whose rules apply
+ * @filepath: File to check
+ *
+ * Return: 0 if the file passes, 1 otherwise
+ */
+int validate_with_rules(const Task *task, const char *filepath)
+{
+	return rules_check(task->rules, task->task_name, filepath);
+}
@@ -0,0 +1,75 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../../main/checker.h"
+
+/*
+ * Declarative validation rules, written per task in the catalog JSON:
+ *
+ *   "rules": {
+ *     "header": ["#!/usr/bin/env python3", ""],
+ *     "signature": "def recursion(*",
+ *     "docstring": "definition",
+ *     "banned": ["for", "while"],
+ *     "required_files": ["__init__.py"]
+ *   }
+ *
+ * "header" lines must open the file exactly (leading blanks ignored).
+ * "signature" is a glob ('*' any run, '?' any character) the first
+ * non-blank line after the header (and module docstring) must match.
+ * "docstring" is "module" (first statement after the header), "definition"
+ * (first line after the signature) or "none". "banned" tokens may not
+ * appear as whole words in code; strings and comments are skipped, and
+ * every hit is reported with its line and column.
+ * "required_files" are added to the task's expected files by the loader
+ * and never reach the compiler.
+ */
+
+#define RULES_MAX_STATES 0x7fff
+#define RULES_STATE_MATCH 0x8000 /* set in next[] entries leading to a match */
+#define RULES_CLASS_LEXER 0xff   /* class of the bytes the lexer acts on */
+#define RULES_MAX_STARTS 16      /* start bytes the scanner can skip to with SIMD */
+#define RULES_MAX_HITS 20        /* banned tokens reported per file */
+
+typedef enum {
+	DOCSTRING_NONE = 0,
+	DOCSTRING_MODULE,
+	DOCSTRING_DEFINITION
+} DocstringRule;
+
+/*
+ * A compiled rule set. The banned tokens form one Aho-Corasick automaton,
+ * stored as a dense transition table over byte classes so the scanner
+ * takes a single table step per byte of code. Newlines, quotes and '#'
+ * get RULES_CLASS_LEXER instead, which hands the byte to the lexer.
+ * From the root state only the bytes in starts[] do anything, so the
+ * scanner skips ahead to the next of them 16 bytes at a time.
+ */
+typedef struct {
+	const char **header;
+	int header_count;
+	const char *signature;
+	DocstringRule docstring;
+	const char **banned;
+	int banned_count;
+
+	unsigned char classes[256]; /* byte -> class, 0 for bytes in no token */
+	int class_count;
+	int state_count;
+	uint16_t *next;             /* state * class_count + class -> state */
+	int16_t *match;             /* state -> banned token ending there, -1 if none */
+	uint16_t *match_link;       /* state -> nearest suffix state with a match, 0 if none */
+	unsigned char starts[RULES_MAX_STARTS]; /* bytes leaving the root, lexer bytes included */
+	int start_count;            /* 0 if there are too many to skip to */
+} RuleSet;
+
+RuleSet *rules_compile(const char *json, Arena *arena);
+int rules_scan(const RuleSet *rules, const char *task_name,
+		const char *filepath, const char *data, size_t size);
+int rules_check_file(const RuleSet *rules, const char *task_name, const char *filepath);
+int rules_check(const char *json, const char *task_name, const char *filepath);
+int validate_with_rules(const Task *task, const char *filepath);
+
+#endif
@@ -0,0 +1,448 @@
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "rules.h"
+#include "../../utils/utils.h"
+#include "../../reporter/reporter.h"
+
+/*
+ * Single-pass rule scanner. One walk over the file drives three things at
+ * once: a small Python lexer (code, comment, string) so banned tokens are
+ * only looked for in code, the banned-token automaton, and the line rules
+ * (header, docstring, signature), which are checked as each line starts
+ * and stop costing anything once they are satisfied. Runs of code that
+ * cannot start a token, and string bodies, are skipped with find_any(),
+ * which compares 16 bytes at once where SSE2 is available.
+ */
+
+#define CHUNK 16
+
+/* A few bytes to search for, broadcast once per scan */
+typedef struct {
+#ifdef __SSE2__
+	__m128i lanes[RULES_MAX_STARTS];
+#endif
+	unsigned char bytes[RULES_MAX_STARTS];
+	int count;
+} ByteSet;
+
+typedef enum {
+	EXPECT_HEADER,
+	EXPECT_MODULE_DOC,
+	EXPECT_SIGNATURE,
+	EXPECT_DEFINITION_DOC,
+	EXPECT_DONE
+} Expect;
+
+typedef enum {
+	LEX_CODE,
+	LEX_COMMENT,
+	LEX_STRING
+} LexState;
+
+typedef struct {
+	const RuleSet *rules;
+	const char *filepath;
+	Expect expect;
+	int header_line;   /* header lines matched so far */
+	int line;
+	size_t line_start; /* offset of the current line, for columns */
+	int hits;          /* banned tokens found */
+} Scan;
+
+static Expect next_expect(const RuleSet *rules, Expect after)
+{
+	if (after < EXPECT_MODULE_DOC && rules->docstring == DOCSTRING_MODULE)
+		return EXPECT_MODULE_DOC;
+	if (after < EXPECT_SIGNATURE && rules->signature)
+		return EXPECT_SIGNATURE;
+	if (after < EXPECT_DEFINITION_DOC && rules->docstring == DOCSTRING_DEFINITION)
+		return EXPECT_DEFINITION_DOC;
+	return EXPECT_DONE;
+}
+
+static void byte_set_init(ByteSet *set, const unsigned char *bytes, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		set->bytes[i] = bytes[i];
+#ifdef __SSE2__
+		set->lanes[i] = _mm_set1_epi8((char)bytes[i]);
+#endif
+	}
+	set->count = count;
+}
+
+/* Offset of the first byte at or after @pos that is in @set, @size if none */
+static size_t find_any(const ByteSet *set, const unsigned char *buf, size_t pos, size_t size)
+{
+	int i;
+#ifdef __SSE2__
+	__m128i chunk, hits;
+	unsigned int mask;
+
+	for (; pos + CHUNK <= size; pos += CHUNK)
+	{
+		chunk = _mm_loadu_si128((const __m128i *)(buf + pos));
+		hits = _mm_cmpeq_epi8(chunk, set->lanes[0]);
+		for (i = 1; i < set->count; i++)
+			hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, set->lanes[i]));
+		mask = (unsigned int)_mm_movemask_epi8(hits);
+		if (mask)
+			return pos + __builtin_ctz(mask);
+	}
+#endif
+	for (; pos < size; pos++)
+	{
+		for (i = 0; i < set->count; i++)
+		{
+			if (buf[pos] == set->bytes[i])
+				return pos;
+		}
+	}
+	return size;
+}
+
+static int is_ident(unsigned char c)
+{
+	return c == '_' || c >= 0x80 || (c >= '0' && c <= '9') ||
+		(c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+/* Whole-text glob match: '*' matches any run of characters, '?' any one */
+static int glob_match(const char *pattern, const char *text, size_t len)
+{
+	const char *star = NULL;
+	size_t i = 0, resume = 0;
+
+	while (i < len)
+	{
+		if (*pattern == '*')
+		{
+			star = pattern++;
+			resume = i;
+		}
+		else if (*pattern && (*pattern == '?' || *pattern == text[i]))
+		{
+			pattern++;
+			i++;
+		}
+		else if (star)
+		{
+			pattern = star + 1;
+			i = ++resume;
+		}
+		else
+		{
+			return 0;
+		}
+	}
+	while (*pattern == '*')
+		pattern++;
+	return *pattern == '\0';
+}
+
+static int opens_docstring(const char *text, size_t len)
+{
+	return len >= 3 && (strncmp(text, "\"\"\"", 3) == 0 || strncmp(text, "'''", 3) == 0);
+}
+
+/* Applies the pending line rule to one line, leading blanks stripped */
+static int check_line(Scan *scan, const char *text, size_t len)
+{
+	const RuleSet *rules = scan->rules;
+	const char *want;
+
+	switch (scan->expect)
+	{
+	case EXPECT_HEADER:
+		want = rules->header[scan->header_line];
+		if (strlen(want) != len || strncmp(want, text, len) != 0)
+		{
+			if (*want == '\0')
+				report_error("Error: Line %d must be blank\n", scan->line);
+			else
+				report_error("Error: Line %d must be '%s'\n", scan->line, want);
+			return 1;
+		}
+		if (++scan->header_line < rules->header_count)
+			return 0;
+		break;
+	case EXPECT_MODULE_DOC:
+	case EXPECT_DEFINITION_DOC:
+		if (len == 0)
+			return 0;
+		if (!opens_docstring(text, len))
+		{
+			if (scan->expect == EXPECT_MODULE_DOC)
+				report_error("Error: Expected a module docstring (\"\"\" or ''') on line %d\n",
+						scan->line);
+			else
+				report_error("Error: Expected a docstring (\"\"\" or ''') on line %d, "
+						"immediately after '%s'\n", scan->line, rules->signature);
+			return 1;
+		}
+		break;
+	case EXPECT_SIGNATURE:
+		if (len == 0)
+			return 0;
+		if (!glob_match(rules->signature, text, len))
+		{
+			report_error("Error: Expected '%s' on line %d\n", rules->signature, scan->line);
+			return 1;
+		}
+		break;
+	default:
+		return 0;
+	}
+	scan->expect = next_expect(rules, scan->expect);
+	return 0;
+}
+
+static int check_end(const Scan *scan, size_t size)
+{
+	const RuleSet *rules = scan->rules;
+
+	switch (scan->expect)
+	{
+	case EXPECT_HEADER:
+		if (size == 0)
+			report_error("Error: %s is empty\n", scan->filepath);
+		else
+			report_error("Error: Line %d missing in %s\n", scan->header_line + 1, scan->filepath);
+		return 1;
+	case EXPECT_MODULE_DOC:
+		report_error("Error: Module docstring not found in %s\n", scan->filepath);
+		return 1;
+	case EXPECT_SIGNATURE:
+		report_error("Error: Expected '%s' in %s\n", rules->signature, scan->filepath);
+		return 1;
+	case EXPECT_DEFINITION_DOC:
+		report_error("Error: Docstring not found after '%s'\n", rules->signature);
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/* Banned token ending at @pos with word boundaries on both sides, or -1 */
+static int banned_at(const RuleSet *rules, const unsigned char *buf, size_t pos,
+		size_t size, int state)
+{
+	const char *token;
+	size_t len;
+	int t;
+
+	for (; state; state = rules->match_link[state])
+	{
+		t = rules->match[state];
+		if (t < 0)
+			continue;
+		token = rules->banned[t];
+		len = strlen(token);
+		if (is_ident(token[0]) && pos + 1 > len && is_ident(buf[pos - len]))
+			continue;
+		if (is_ident(token[len - 1]) && pos + 1 < size && is_ident(buf[pos + 1]))
+			continue;
+		return t;
+	}
+	return -1;
+}
+
+/* Applies the pending line rule to the line starting at @pos */
+static int start_line(Scan *scan, const char *data, size_t pos, size_t size)
+{
+	const char *text = data + pos, *end;
+	size_t len;
+
+	end = memchr(text, '\n', size - pos);
+	len = end ? (size_t)(end - text) : size - pos;
+	if (len > 0 && text[len - 1] == '\r')
+		len--;
+	while (len > 0 && (*text == ' ' || *text == '\t'))
+	{
+		text++;
+		len--;
+	}
+	return check_line(scan, text, len);
+}
+
+/* Reports the banned token ending at @pos, if there is one */
+static void check_banned(Scan *scan, const char *task_name, const unsigned char *buf,
+		size_t pos, size_t size, int state)
+{
+	const RuleSet *rules = scan->rules;
+	size_t start;
+	int token;
+
+	token = banned_at(rules, buf, pos, size, state);
+	if (token < 0)
+		return;
+	if (++scan->hits <= RULES_MAX_HITS)
+	{
+		start = pos + 1 - strlen(rules->banned[token]);
+		report_error("Error: '%s' is not allowed in %s tasks (line %d, column %d)\n",
+				rules->banned[token], task_name, scan->line, (int)(start - scan->line_start) + 1);
+	}
+}
+
+/* Skips the string opening at @pos, returns the offset just after it */
+static size_t skip_string(Scan *scan, const ByteSet *stops, const unsigned char *buf,
+		size_t pos, size_t size)
+{
+	unsigned char quote = buf[pos], c;
+	int triple;
+
+	triple = pos + 2 < size && buf[pos + 1] == quote && buf[pos + 2] == quote;
+	for (pos += triple ? 3 : 1; (pos = find_any(stops, buf, pos, size)) < size; pos++)
+	{
+		c = buf[pos];
+		if (c == '\\' && pos + 1 < size)
+		{
+			/* The escaped character never ends the string, a newline still counts */
+			if (buf[++pos] == '\n')
+			{
+				scan->line++;
+				scan->line_start = pos + 1;
+			}
+		}
+		else if (c == quote && (!triple ||
+					(pos + 2 < size && buf[pos + 1] == quote && buf[pos + 2] == quote)))
+		{
+			return pos + (triple ? 3 : 1);
+		}
+		else if (c == '\n')
+		{
+			/* Unterminated string: Python rejects it, resync at the newline */
+			if (!triple)
+				return pos;
+			scan->line++;
+			scan->line_start = pos + 1;
+		}
+	}
+	return size;
+}
+
+/**
+ * rules_scan - Checks a file's contents against a rule set in one pass.
+ * @rules: Compiled rules
+ * @task_name: Task the file belongs to, for messages
+ * @filepath: File the contents came from, for messages
+ * @data: File contents
+ * @size: Number of bytes in @data
+ *
+ * Line rules stop the scan at their first violation; banned tokens are all
+ * reported (up to RULES_MAX_HITS) with their line and column.
+ *
+ * Return: 0 if every rule holds, 1 otherwise
+ */
+int rules_scan(const RuleSet *rules, const char *task_name,
+		const char *filepath, const char *data, size_t size)
+{
+	static const unsigned char double_stops[] = { '"', '\\', '\n' };
+	static const unsigned char single_stops[] = { '\'', '\\', '\n' };
+	const unsigned char *buf = (const unsigned char *)data;
+	const unsigned char *classes = rules->classes;
+	const uint16_t *next = rules->next;
+	ByteSet starts, double_quoted, single_quoted;
+	const char *stop;
+	unsigned char c, cls;
+	size_t pos = 0;
+	int state = 0;
+	Scan scan;
+
+	byte_set_init(&starts, rules->starts, rules->start_count);
+	byte_set_init(&double_quoted, double_stops, sizeof(double_stops));
+	byte_set_init(&single_quoted, single_stops, sizeof(single_stops));
+	scan.rules = rules;
+	scan.filepath = filepath;
+	scan.header_line = 0;
+	scan.line = 1;
+	scan.line_start = 0;
+	scan.hits = 0;
+	scan.expect = rules->header_count > 0 ? EXPECT_HEADER : next_expect(rules, EXPECT_HEADER);
+	if (size > 0 && scan.expect != EXPECT_DONE && start_line(&scan, data, 0, size) != 0)
+		return 1;
+
+	while (pos < size)
+	{
+		/* At the root, jump to the next byte that can start a token or needs the lexer */
+		if (state == 0 && starts.count > 0)
+		{
+			pos = find_any(&starts, buf, pos, size);
+			if (pos == size)
+				break;
+		}
+
+		/* Code: one table step per byte until the lexer has to act */
+		cls = classes[buf[pos]];
+		if (cls != RULES_CLASS_LEXER)
+		{
+			state = next[state * rules->class_count + cls];
+			if (state & RULES_STATE_MATCH)
+			{
+				state &= ~RULES_STATE_MATCH;
+				check_banned(&scan, task_name, buf, pos, size, state);
+			}
+			pos++;
+			continue;
+		}
+
+		state = 0;
+		c = buf[pos];
+		if (c == '#')
+		{
+			/* Comment: resume at its newline */
+			stop = memchr(data + pos, '\n', size - pos);
+			pos = stop ? (size_t)(stop - data) : size;
+			continue;
+		}
+		if (c == '"' || c == '\'')
+		{
+			pos = skip_string(&scan, c == '"' ? &double_quoted : &single_quoted, buf, pos, size);
+			continue;
+		}
+
+		/* Newline in code; lines that start inside a string skip the line rules */
+		scan.line++;
+		scan.line_start = ++pos;
+		if (scan.expect != EXPECT_DONE && pos < size && start_line(&scan, data, pos, size) != 0)
+			return 1;
+	}
+
+	if (scan.hits > RULES_MAX_HITS)
+		report_error("Error: %d more banned tokens in %s\n", scan.hits - RULES_MAX_HITS, filepath);
+	return check_end(&scan, size) || scan.hits > 0;
+}
+
+/**
+ * rules_check_file - Checks a file against a rule set.
+ * @rules: Compiled rules
+ * @task_name: Task the file belongs to
+ * @filepath: File to check
+ *
+ * Return: 0 if the file passes, 1 otherwise
+ */
+int rules_check_file(const RuleSet *rules, const char *task_name, const char *filepath)
+{
+	CachedFile *file;
+	int result;
+
+	/* Shared with the other checks of the run, unmapped by file_cache_clear() */
+	file = file_cache_load(filepath);
+	if (!file)
+	{
+		report_error("Error opening file: %s\n", filepath);
+		return 1;
+	}
+	result = rules_scan(rules, task_name, filepath, file->data, file->size);
+
+	/* Only successful result is animated */
+	if (result == 0)
+		report_progress(25000, "%s passed %s file checks.\n", filepath, task_name);
+	return result;
+}
@@ -2,48 +2,70 @@
 #include <string.h>
 #include "../main/checker.h"
 #include "validators.h"
+#include "../reporter/reporter.h"
+#include "../trace/trace.h"
+#include "../metrics/metrics.h"
 #include "./hash/registry_hash.h"
-#include "./hash/hash.h"
+#include "./rules/rules.h"
 
+/* A plugin validator wins over the task's catalog rules */
 int dispatch_validation(Task *task, const char *filepath)
 {
 	ValidatorFn fn = get_validator(task->task_name);
-	if (fn)
-		return fn(filepath);
-	else {
-		fprintf(stderr, "No validator found for task: %s\n", task->task_name);
-		printf("/n");
+	int result;
+
+	if (fn) {
+		TRACE_BEGIN("validator", task->task_name);
+		result = fn(filepath);
+		TRACE_END("validator");
+		return result;
+	} else if (task->rules) {
+		TRACE_BEGIN("validator", task->task_name);
+		result = validate_with_rules(task, filepath);
+		TRACE_END("validator");
+		return result;
+	} else {
+		report_error("No validator found for task: %s\n", task->task_name);
+		report_info("\n");
 		return 1;
 	}
 }
 
+/* Returns STAGE_NONE when every check passed, else the stage that failed */
 int validate_task(Task *task, const char *filepath)
 {
-	int is_python, result;
+	int is_python, result, readme_ok, lint_result;
+	double lint_start;
 
-	if (!check_readme(task->expected_path))
+	TRACE_BEGIN("check_readme", task->expected_path);
+	readme_ok = check_readme(task->expected_path);
+	TRACE_END("check_readme");
+	if (!readme_ok)
 	{
-		fprintf(stderr, "Missing or empty README.md in %s\n", task->expected_path);
-		printf("/n");
-		return 1;
+		report_error("Missing or empty README.md in %s\n", task->expected_path);
+		report_info("\n");
+		return STAGE_README;
 	}
 
 	is_python = is_python_file(task->target_file);
 
-	if (is_python) {
-		if (run_pycodestyle(filepath) != 0)
-			return 1;
-	} else {
-		if (run_betty_linter(filepath) != 0)
-			return 1;
-	}
+	TRACE_BEGIN("lint", filepath);
+	lint_start = metrics_now();
+	if (is_python)
+		lint_result = run_pycodestyle(filepath);
+	else
+		lint_result = run_betty_linter(filepath);
+	metrics_observe(HIST_LINT, lint_start);
+	TRACE_END("lint");
+	if (lint_result != 0)
+		return STAGE_LINT;
 
-	result = dispatch_validation(task, filepath);
+	result = dispatch_validation(task, filepath) != 0 ? STAGE_VALIDATOR : STAGE_NONE;
 
 	/*
 	   if (check_plagiarism(filepath, task) != 0)
 	   {
-	   fprintf(stderr, "Plagiarism check failed for file: %s\n", filepath);
+	   report_error("Plagiarism check failed for file: %s\n", filepath);
 	   return 1;
 	   }
 	   */
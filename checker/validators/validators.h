@@ -7,6 +7,9 @@
 
 #define HASH_LENGTH 65
 
+/* Part of every cached result key: bump when a validator or linter rule changes */
+#define VALIDATOR_VERSION "4"
+
 typedef struct {
 	const char *task_name;
 	ValidatorFn validator;
@@ -15,8 +18,6 @@ typedef struct {
 int dispatch_validation(Task *task, const char *filepath);
 
 int validate_task(Task *task, const char *filepath);
-int validate_recursion_file(const char *filepath);
-int validate_factorial_file(const char *filepath);
 
 int compute_file_hash(const char *filepath, char *output_hex);
 int is_duplicate_hash(const char *username, const char *filepath, const char *hash, const char *log_path);